@@ -0,0 +1,96 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <catch2/catch.hpp>
+
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "util.hpp"
+
+
+namespace
+{
+
+// NOTE - The std::regex parsers util.hpp used before, kept as the baseline.
+std::regex const codes_regex{"(\\d{3})"};
+std::regex const pasv_reply_regex{
+    R"###(\((\d{1,3}),(\d{1,3}),(\d{1,3}),(\d{1,3}),(\d{1,3}),(\d{1,3})\))###"
+};
+std::regex const epsv_reply_regex{R"###(\(\|([12])?\|(.+)?\|([0-9]{1,5})\|\))###"};
+
+auto regex_parse_codes(std::string const& a_reply_str) -> std::vector<rs::ftp::reply_code>
+{
+    std::smatch codes_match;
+    std::vector<rs::ftp::reply_code> ret_codes;
+    std::string search_str{a_reply_str};
+
+    while (std::regex_search(search_str, codes_match, codes_regex))
+    {
+        ret_codes.push_back(static_cast<rs::ftp::reply_code>(std::stoi(codes_match.str())));
+        search_str = codes_match.suffix();
+    }
+
+    return ret_codes;
+}
+
+auto regex_parse_pasv_port(std::string const& a_pasv_reply) -> unsigned short
+{
+    std::smatch match;
+    std::regex_search(a_pasv_reply, match, pasv_reply_regex);
+
+    return (256 * std::stoi(match[5])) + std::stoi(match[6]);
+}
+
+auto regex_parse_epsv_port(std::string const& a_epsv_reply) -> unsigned short
+{
+    std::smatch match;
+    std::regex_search(a_epsv_reply, match, epsv_reply_regex);
+
+    return std::stoi(match[3]);
+}
+
+std::string const size_reply{"213 1048576 bytes in 4096 blocks of 256\r\n"};
+std::string const pasv_reply{"227 Entering Passive Mode (192,168,100,200,195,80).\r\n"};
+std::string const epsv_reply{"229 Entering Extended Passive Mode (|||50000|)\r\n"};
+
+}   // namespace
+
+TEST_CASE("Reply parse benchmark", "[benchmark]")
+{
+    REQUIRE(rs::ftp::parse_reply_code(size_reply) == regex_parse_codes(size_reply).front());
+    REQUIRE(std::get<1>(rs::ftp::parse_pasv_ipv4_port_reply(pasv_reply)) ==
+        regex_parse_pasv_port(pasv_reply));
+    REQUIRE(rs::ftp::parse_epsv_reply(epsv_reply).port == regex_parse_epsv_port(epsv_reply));
+
+    BENCHMARK("Reply code - std::regex")
+    {
+        return regex_parse_codes(size_reply).front();
+    };
+
+    BENCHMARK("Reply code - string_view")
+    {
+        return rs::ftp::parse_reply_code(size_reply);
+    };
+
+    BENCHMARK("PASV - std::regex")
+    {
+        return regex_parse_pasv_port(pasv_reply);
+    };
+
+    BENCHMARK("PASV - string_view")
+    {
+        return rs::ftp::parse_pasv_ipv4_port_reply(pasv_reply);
+    };
+
+    BENCHMARK("EPSV - std::regex")
+    {
+        return regex_parse_epsv_port(epsv_reply);
+    };
+
+    BENCHMARK("EPSV - string_view")
+    {
+        return rs::ftp::parse_epsv_reply(epsv_reply);
+    };
+}
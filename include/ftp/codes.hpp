@@ -3,9 +3,18 @@
  */
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <cassert>
+#include <cstdint>
 #include <exception>
+#include <initializer_list>
+
+// NOTE - The system socket headers define AF_INET6 as a macro, which clashes with
+//        address_family::AF_INET6 when they are included first.
+#pragma push_macro("AF_INET6")
+#undef AF_INET6
 
 
 namespace rs
@@ -34,7 +43,7 @@ enum class data_type
     LOCAL,
 };
 
-inline auto data_type_to_str(data_type a_data_type) noexcept -> std::string
+constexpr auto data_type_to_str(data_type a_data_type) noexcept -> std::string_view
 {
     switch (a_data_type)
     {
@@ -66,7 +75,7 @@ enum class file_structure
     PAGE_STRUCTURE,
 };
 
-inline auto file_structure_to_str(file_structure a_file_structure) noexcept -> std::string
+constexpr auto file_structure_to_str(file_structure a_file_structure) noexcept -> std::string_view
 {
     switch (a_file_structure)
     {
@@ -88,7 +97,8 @@ enum class transmission_mode
     STREAM,
 };
 
-inline auto transmission_mode_to_str(transmission_mode a_transmission_mode) noexcept -> std::string
+constexpr auto transmission_mode_to_str(transmission_mode a_transmission_mode) noexcept
+-> std::string_view
 {
     switch (a_transmission_mode)
     {
@@ -119,7 +129,10 @@ enum class data_channel_protection_level
     PRIVATE,
 };
 
-inline auto data_channel_protection_level_to_str(data_channel_protection_level a_protection_level) noexcept -> std::string
+constexpr auto data_channel_protection_level_to_str(
+    data_channel_protection_level a_protection_level
+)
+noexcept -> std::string_view
 {
     switch (a_protection_level)
     {
@@ -141,7 +154,8 @@ enum class authentication_method
     TLS,
 };
 
-inline auto authentication_method_to_str(authentication_method a_auth_method)
+constexpr auto authentication_method_to_str(authentication_method a_auth_method) noexcept
+-> std::string_view
 {
     switch (a_auth_method)
     {
@@ -159,7 +173,7 @@ enum class address_family
     ALL,
 };
 
-inline auto address_family_to_str(address_family a_af)
+constexpr auto address_family_to_str(address_family a_af) noexcept -> std::string_view
 {
     switch (a_af)
     {
@@ -486,9 +500,34 @@ enum class ftp_command
      * 500, 501, 522
      */
     EPSV,
+    /**
+     * RFC2389 commands
+     */
+    /**
+     * 211
+     * 500, 502
+     */
+    FEAT,
+    /**
+     * RFC3659 commands
+     */
+    /**
+     * 213
+     * 550
+     * 500, 501, 502, 504, 421, 530
+     */
+    SIZE,
+    /**
+     * 150
+     *    226, 250
+     *    425, 426, 451
+     * 450, 501, 550
+     * 500, 502, 421, 530
+     */
+    MLSD,
 };
 
-inline auto ftp_command_to_str(ftp_command a_ftp_command) noexcept -> std::string
+constexpr auto ftp_command_to_str(ftp_command a_ftp_command) noexcept -> std::string_view
 {
     switch (a_ftp_command)
     {
@@ -578,6 +617,12 @@ inline auto ftp_command_to_str(ftp_command a_ftp_command) noexcept -> std::strin
         return "EPRT";
     case ftp_command::EPSV:
         return "EPSV";
+    case ftp_command::FEAT:
+        return "FEAT";
+    case ftp_command::SIZE:
+        return "SIZE";
+    case ftp_command::MLSD:
+        return "MLSD";
     default:
         return "unknown command";
     }
@@ -741,7 +786,7 @@ enum class reply_code
     REQUESTED_NETWORK_PROTOCOL_UNSUPPORTED_522 = 522,
 };
 
-inline auto reply_code_to_str(reply_code a_reply_code) noexcept -> std::string
+constexpr auto reply_code_to_str(reply_code a_reply_code) noexcept -> std::string_view
 {
     switch (a_reply_code)
     {
@@ -862,6 +907,54 @@ inline auto reply_code_to_str(reply_code a_reply_code) noexcept -> std::string
     }
 }
 
+/**
+ * Set of reply codes, a bitset over 100-699. Usable in constant expressions - checking a reply
+ * against it is a single bit test.
+ */
+class reply_code_set
+{
+public:
+    constexpr reply_code_set() noexcept =default;
+    constexpr reply_code_set(std::initializer_list<reply_code> a_codes) noexcept
+    {
+        for (auto const code : a_codes)
+        {
+            insert(code);
+        }
+    }
+
+    constexpr auto insert(reply_code a_code) noexcept -> void
+    {
+        auto const bit = index(a_code);
+
+        if (bit < BITS)
+        {
+            m_words[bit / WORD_BITS] |= std::uint64_t{1} << (bit % WORD_BITS);
+        }
+    }
+
+    constexpr auto contains(reply_code a_code) const noexcept -> bool
+    {
+        auto const bit = index(a_code);
+
+        return bit < BITS && (m_words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+    }
+
+private:
+    static constexpr int FIRST_CODE{100};
+    static constexpr unsigned BITS{600};
+    static constexpr unsigned WORD_BITS{64};
+
+    // NOTE - Codes below FIRST_CODE wrap around to large indexes and end up out of range too.
+    static constexpr auto index(reply_code a_code) noexcept -> unsigned
+    {
+        return static_cast<unsigned>(static_cast<int>(a_code) - FIRST_CODE);
+    }
+
+    std::array<std::uint64_t, (BITS + WORD_BITS - 1) / WORD_BITS> m_words{};
+};
+
 }   // namespace ftp
 }   // namespace rs
 
+#pragma pop_macro("AF_INET6")
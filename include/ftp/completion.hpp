@@ -0,0 +1,86 @@
+/**
+ * @file completion.hpp
+ */
+#pragma once
+
+#include <tuple>
+#include <memory>
+#include <utility>
+#include <exception>
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+
+namespace rs
+{
+namespace ftp
+{
+
+/**
+ * @brief Adapts an Asio completion token to a type erased std::function handler.
+ *
+ * The initiation runs on a_io_context and receives a copyable handler with the signature
+ * void(std::exception_ptr, Results...). The final handler is invoked on its associated executor -
+ * defaulting to a_io_context - which is kept busy until then.
+ *
+ * @param[in] a_io_context
+ * @param[in] a_token
+ * @param[in] a_initiation Called with the type erased handler.
+ */
+template <typename CompletionToken, typename... Results, typename Initiation>
+auto initiate_operation(
+    boost::asio::io_context& a_io_context,
+    CompletionToken& a_token,
+    Initiation&& a_initiation
+)
+{
+    return boost::asio::async_initiate<CompletionToken, void(std::exception_ptr, Results...)>(
+        [&a_io_context](auto a_handler, auto a_start) -> void
+        {
+            auto handler = std::make_shared<decltype(a_handler)>(std::move(a_handler));
+            auto work = boost::asio::make_work_guard(
+                boost::asio::get_associated_executor(*handler, a_io_context.get_executor())
+            );
+
+            auto complete = [handler, work](std::exception_ptr a_error, Results... a_results)
+            mutable -> void
+            {
+                auto executor = work.get_executor();
+                work.reset();
+                boost::asio::dispatch(
+                    executor,
+                    [handler, a_error, results = std::make_tuple(std::move(a_results)...)]()
+                    mutable -> void
+                    {
+                        std::apply(
+                            [&handler, &a_error](auto&&... a_values) -> void
+                            {
+                                (*handler)(a_error, std::move(a_values)...);
+                            },
+                            std::move(results)
+                        );
+                    }
+                );
+            };
+
+            // NOTE - Started on the reactor - from another thread it would race the handlers of
+            //        the connection still running there, such as the end of the previous operation.
+            boost::asio::dispatch(
+                a_io_context,
+                [a_start = std::move(a_start), complete = std::move(complete)]() mutable -> void
+                {
+                    a_start(std::move(complete));
+                }
+            );
+        },
+        a_token,
+        std::forward<Initiation>(a_initiation)
+    );
+}
+
+}   // namespace ftp
+}   // namespace rs
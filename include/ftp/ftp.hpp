@@ -6,11 +6,18 @@
 #include <memory>
 #include <vector>
 #include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <exception>
+#include <filesystem>
 #include <functional>
+#include <type_traits>
+
+#include <boost/asio/io_context.hpp>
 
 #include "codes.hpp"
+#include "listing.hpp"
+#include "completion.hpp"
 
 
 namespace rs
@@ -18,6 +25,31 @@ namespace rs
 namespace ftp
 {
 
+/**
+ * Transport tuning of a socket, applied before it connects. Failing to set an option is logged as
+ * a warning and does not fail the connect. Zero keeps the system default.
+ */
+struct socket_options
+{
+    // TCP_NODELAY - small writes go out at once instead of waiting for the previous ACK.
+    bool no_delay{false};
+    // SO_RCVBUF/SO_SNDBUF in bytes - a long fat link needs them at least as large as its
+    // bandwidth-delay product.
+    int receive_buffer_size{0};
+    int send_buffer_size{0};
+    // SO_KEEPALIVE, the probe parameters (TCP_KEEPIDLE/TCP_KEEPINTVL/TCP_KEEPCNT) where available.
+    bool keep_alive{false};
+    std::chrono::seconds keep_alive_idle{0};
+    std::chrono::seconds keep_alive_interval{0};
+    int keep_alive_count{0};
+    // TCP_QUICKACK, Linux only - ACKs are not delayed.
+    bool quick_ack{false};
+    // IP_TOS, or IPV6_TCLASS - the DSCP goes in the upper six bits. Negative to leave it unset.
+    int type_of_service{-1};
+    // SO_BUSY_POLL, Linux only - how long a read busy polls the device queue.
+    std::chrono::microseconds busy_poll{0};
+};
+
 struct connection_options
 {
     std::string username{};
@@ -33,7 +65,44 @@ struct connection_options
      * @warning Affects all instances of the class.
      */
     bool debug_output{false};
+    /**
+     * How long a single read, write or connect may wait without completing.
+     */
     std::chrono::milliseconds timeout{60000};
+    /**
+     * How long establishing a connection may take, across all the addresses tried.
+     */
+    std::chrono::milliseconds connect_timeout{10000};
+    /**
+     * When a host resolves to several addresses, the next one is tried after this long without
+     * waiting for the previous attempt to fail - IPv6 and IPv4 addresses alternate (RFC8305).
+     */
+    std::chrono::milliseconds connect_attempt_delay{250};
+    /**
+     * How long the data connection of a transfer may stay open, however steadily data flows.
+     * Zero for no limit.
+     */
+    std::chrono::milliseconds transfer_timeout{0};
+    /**
+     * How long a resolved server_hostname is reused by the connects of all clients. Zero to
+     * resolve on every connect. A connect to the cached addresses that fails, other than by
+     * timing out, drops them and is retried once with a fresh resolution.
+     */
+    std::chrono::seconds resolve_cache_ttl{60};
+    /**
+     * client::download_files sends the EPSV for the next file while the current one is still
+     * arriving, saving a round trip per file. Only for servers that queue commands received during
+     * a transfer - others may take the EPSV for an attempt to abort it.
+     */
+    bool pipeline_passive_mode{false};
+    /**
+     * Tuning of the control connection - replies to short commands should not wait for ACKs.
+     */
+    socket_options control_socket{true};
+    /**
+     * Tuning of the data connections.
+     */
+    socket_options data_socket{};
     // @Unimplemented
     data_type type{data_type::ASCII};
     // @Unimplemented
@@ -44,48 +113,248 @@ struct connection_options
     file_structure structure{file_structure::FILE_STRUCTURE};
 };
 
+class command_line;
+
+/**
+ * Control connection commands sent back to back by client::execute, without waiting for the reply
+ * of the previous command. Every reply is checked against the codes the equivalent client method
+ * accepts.
+ */
+class command_batch
+{
+public:
+    auto cwd(std::string const& a_new_wd) -> command_batch&;
+    auto cdup() -> command_batch&;
+    /**
+     * @brief Queues a RNFR/RNTO pair - two commands, two replies.
+     */
+    auto rename(
+        std::string const& a_file_to_rename,
+        std::string const& a_rename_to
+    )
+    -> command_batch&;
+    auto remove_file(std::string const& a_filepath) -> command_batch&;
+    auto rmdir(std::string const& a_dirpath) -> command_batch&;
+    auto mkdir(std::string const& a_dirpath) -> command_batch&;
+    auto noop() -> command_batch&;
+
+    /**
+     * @brief Number of queued commands.
+     */
+    auto size() const noexcept -> std::size_t;
+    auto empty() const noexcept -> bool;
+
+private:
+    friend class client;
+
+    struct command
+    {
+        // NOTE - Where the line of the command ends in m_buffer.
+        std::size_t m_end;
+        reply_code_set m_accepted_codes;
+    };
+
+    auto add(
+        command_line const& a_command,
+        reply_code_set a_accepted_codes
+    )
+    -> command_batch&;
+
+    // NOTE - The lines of all commands, back to back - a window is written straight out of it.
+    std::string m_buffer;
+    std::vector<command> m_commands;
+};
+
+/**
+ * Reply to a single command of a command_batch.
+ */
+struct command_reply
+{
+    std::string reply{};
+    // The exception the equivalent blocking call would have thrown, if the command was rejected.
+    std::exception_ptr error{};
+};
+
+/**
+ * Every operation is available as a blocking call and as an async_* call.
+ *
+ * The async_* calls accept any Asio completion token - a callback, boost::asio::use_future,
+ * boost::asio::use_awaitable, etc. Errors are passed as a std::exception_ptr holding the exception
+ * the blocking call would have thrown. The client and the streams passed by reference must outlive
+ * the operation. Only one operation may be in progress per client at a time.
+ */
 class client
 {
+    using completion_handler = std::function<void(std::exception_ptr)>;
+    using string_completion_handler = std::function<void(std::exception_ptr, std::string)>;
+    using bytes_completion_handler = std::function<void(std::exception_ptr, std::vector<char>)>;
+    using size_completion_handler = std::function<void(std::exception_ptr, std::size_t)>;
+    using features_completion_handler = std::function<
+        void(std::exception_ptr, std::vector<std::string>)
+    >;
+    using listing_completion_handler = std::function<
+        void(std::exception_ptr, directory_listing)
+    >;
+    using batch_completion_handler = std::function<
+        void(std::exception_ptr, std::vector<command_reply>)
+    >;
+
     class connection
     {
     public:
-        connection();
+        explicit connection(boost::asio::io_context& a_io_context);
         ~connection() noexcept;
 
-        auto connect(
+        /**
+         * @brief Resolves a_hostname, unless it was resolved less than
+         *        a_options.resolve_cache_ttl ago, and races connects to the resolved addresses.
+         *        When the cached addresses refuse the connect, or it fails in any other way
+         *        than a timeout, they are dropped, a_hostname is resolved again and the connect
+         *        retried once. A timeout is reported as is, it used up the connect timeout.
+         */
+        auto async_connect(
             std::string const& a_hostname,
             int a_port,
-            std::chrono::milliseconds const& a_timeout
+            connection_options const& a_options,
+            completion_handler a_handler
+        )
+        -> void;
+
+        /**
+         * @brief Connects to a_port of the address a_connection is connected to.
+         */
+        auto async_connect(
+            connection const& a_connection,
+            unsigned short a_port,
+            connection_options const& a_options,
+            completion_handler a_handler
         )
         -> void;
 
         auto close() -> void;
 
-        auto read(int a_max)
-        -> std::vector<char>;
+        /**
+         * @brief Closes the socket without a graceful shutdown, ignoring errors. The peer gets a
+         * reset, so a transfer cut short is not taken for a complete one.
+         */
+        auto abort() noexcept -> void;
+
+        /**
+         * @brief Operations still running at a_deadline fail with timeout_error, on top of the
+         *        timeout every operation gets.
+         */
+        auto set_deadline(std::chrono::steady_clock::time_point a_deadline) noexcept -> void;
+
+        /**
+         * @brief Applied to the socket by the next connect.
+         */
+        auto set_socket_options(socket_options const& a_options) noexcept -> void;
+
+        /**
+         * @brief Reads at most a_size bytes into a_buf.
+         *
+         * @warning The buffer must outlive the operation.
+         */
+        auto async_read_some(
+            char* a_buf,
+            std::size_t a_size,
+            size_completion_handler a_handler
+        )
+        -> void;
 
-        auto read_until(std::string const& a_delimiter)
-        -> std::string;
+        /**
+         * @brief Reads a complete RFC959 reply - a single line, or every line of a multi-line
+         * reply ("xyz-" up to "xyz ").
+         *
+         * Bytes received past the reply are kept for the next one.
+         */
+        auto async_read_reply(string_completion_handler a_handler) -> void;
+
+        /**
+         * @brief Writes a_command out of the send buffer of the connection, which is reused.
+         */
+        auto async_write(
+            command_line const& a_command,
+            completion_handler a_handler
+        )
+        -> void;
 
-        auto read_until(char a_delimiter)
-        -> std::string;
+        /**
+         * @warning The buffer must outlive the operation.
+         */
+        auto async_write(
+            char const* a_buf,
+            int a_buf_size,
+            completion_handler a_handler
+        )
+        -> void;
 
-        auto write(std::string const& a_buf)
+        /**
+         * @brief Sends a_count bytes of a file starting at a_offset, or until its end when
+         *        a_count is the maximum std::uint64_t. A file that ends before a_count bytes were
+         *        sent fails the operation. a_offset is ignored for a pipe or a socket, which
+         *        is read from its current position.
+         *
+         * The data goes from the page cache to the socket with sendfile(2) where available,
+         * otherwise it is read into a buffer owned by the connection. A few MiB at a time, so
+         * the other users of a shared reactor are not held up by a large file.
+         */
+        auto async_send_file(
+            int a_fd,
+            std::uint64_t a_offset,
+            std::uint64_t a_count,
+            completion_handler a_handler
+        )
         -> void;
 
-        auto write(char const* a_buf, int a_buf_size)
+        /**
+         * @brief Writes everything read until the peer closes the connection into a file,
+         * starting at a_offset. The offset of a_fd is not moved - a_offset is ignored for a
+         * pipe or a socket, which is written in order.
+         *
+         * The data is moved from the socket to the file with splice(2) through a pipe where
+         * available, a few MiB at a time, otherwise it is read into a buffer owned by the
+         * connection.
+         */
+        auto async_receive_file(
+            int a_fd,
+            std::uint64_t a_offset,
+            completion_handler a_handler
+        )
         -> void;
 
         auto is_open() noexcept -> bool;
 
     private:
         struct impl;
-        std::unique_ptr<impl> m_impl;
+        // NOTE - Shared with the pending handlers, so a connection can be destroyed while they
+        //        are still queued on a shared reactor.
+        std::shared_ptr<impl> m_impl;
     };
 
+    using data_connection_handler = std::function<
+        void(std::exception_ptr, std::shared_ptr<connection>)
+    >;
+
 public:
-    client() =default;
+    client();
     client(connection_options const& a_opts);
+    /**
+     * @brief Runs the client on an externally owned reactor.
+     *
+     * Any number of clients may share one io_context. Blocking calls drive the reactor from the
+     * calling thread only until their own operation completes, so it must not be run by other
+     * threads at the same time - use the async_* calls in that case. A reactor its owner stopped,
+     * or ran until it was out of work, has to be restarted by the owner - until then blocking
+     * calls fail with operation_aborted.
+     *
+     * @param[in] a_io_context Must outlive the client.
+     */
+    explicit client(boost::asio::io_context& a_io_context);
+    client(
+        boost::asio::io_context& a_io_context,
+        connection_options const& a_opts
+    );
 
     /**
      * @brief
@@ -123,14 +392,15 @@ public:
      */
     auto close() -> void;
     /**
-     * @brief
+     * @brief Logs in and switches the session to image type (TYPE I), so sizes and restart
+     *        offsets count the bytes of the files as stored.
      *
      * @throws std::runtime_error If the server returns an unexpected response
      * @throws boost::system::system_error If writing to the socket fails
      */
     auto login() -> void;
     /**
-     * @brief
+     * @brief Same as above, with explicit credentials.
      *
      * @param[in] a_username
      * @param[in] a_password
@@ -173,6 +443,57 @@ public:
      */
     auto download(std::string const& a_filename)
     -> std::vector<char>;
+    /**
+     * @brief Hands the file to a_sink chunk by chunk as it arrives.
+     *
+     * a_sink is any callable taking (char const*, std::size_t) - a hasher, a record parser etc.
+     * It is called directly from the read loop, so it can be inlined there. Throwing from it
+     * aborts the transfer.
+     *
+     * @param[in] a_filename
+     * @param[in] a_sink
+     *
+     * @throws std::runtime_error If parsing the PASV response fails
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or data transfer
+     * connection fails.
+     */
+    template <
+        typename Sink,
+        typename = std::enable_if_t<std::is_invocable_v<Sink&, char const*, std::size_t>>
+    >
+    auto download(
+        std::string const& a_filename,
+        Sink&& a_sink
+    )
+    -> void
+    {
+        run([&, this](completion_handler a_handler) -> void
+        {
+            start_download_to_sink(a_filename, a_sink, std::move(a_handler));
+        });
+    }
+    /**
+     * @brief Downloads straight into caller owned memory - a mmap'd region, a pinned buffer etc.
+     *
+     * @param[in] a_filename
+     * @param[out] a_buffer
+     * @param[in] a_size Size of a_buffer.
+     *
+     * @throws std::length_error If the file does not fit in a_buffer
+     * @throws std::runtime_error If parsing the PASV response fails
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or data transfer
+     * connection fails.
+     *
+     * @returns std::size_t The size of the file.
+     */
+    auto download(
+        std::string const& a_filename,
+        char* a_buffer,
+        std::size_t a_size
+    )
+    -> std::size_t;
     /**
      * @brief
      *
@@ -189,6 +510,108 @@ public:
         std::ofstream& a_ofstream
     )
     -> void;
+    /**
+     * @brief Downloads into a local file without copying the data through user space.
+     *
+     * The data goes to a_local_path with ".part" appended, renamed over a_local_path once the
+     * transfer completed - a failed download leaves an existing a_local_path as it was. Its
+     * space is reserved up front when the server reports the size.
+     *
+     * @param[in] a_filename
+     * @param[in] a_local_path
+     *
+     * @throws std::system_error If the partial file cannot be opened
+     * @throws std::filesystem::filesystem_error If it cannot be renamed to a_local_path
+     * @throws std::runtime_error If parsing the PASV response fails
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or data transfer
+     * connection fails.
+     */
+    auto download(
+        std::string const& a_filename,
+        std::filesystem::path const& a_local_path
+    )
+    -> void;
+    /**
+     * @brief Downloads into a_fd, starting at its current offset.
+     *
+     * The data is written at offsets, so the offset of a_fd is left where it was - seek past
+     * the file to write after it. A pipe or a socket is written in order instead.
+     *
+     * @param[in] a_filename
+     * @param[in] a_fd Not closed - the caller keeps ownership.
+     *
+     * @throws std::runtime_error If parsing the PASV response fails
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or data transfer
+     * connection fails.
+     */
+    auto download(
+        std::string const& a_filename,
+        int a_fd
+    )
+    -> void;
+    /**
+     * @brief Downloads a_filenames back to back over one session - for fetching many small files.
+     *
+     * The transfer reply of a file is read while its data is still being drained. It often
+     * arrives first - the EPSV, connect and RETR of the next file then overlap the rest of the
+     * current one instead of following it. Stops at the first file that fails.
+     *
+     * With connection_options::pipeline_passive_mode the EPSV for the next file is sent while the
+     * current file is still arriving, so its reply follows the transfer reply without a round
+     * trip. This is opt-in because RFC 959 only defines ABOR, STAT and QUIT during a transfer -
+     * a server may answer an early EPSV at once, or take it for an abort.
+     *
+     * @param[in] a_filenames
+     * @param[in] a_data_callback Receives the index of the file in a_filenames and its data as it
+     * arrives.
+     *
+     * @throws std::runtime_error If parsing the EPSV response fails
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or data transfer
+     * connection fails.
+     */
+    auto download_files(
+        std::vector<std::string> const& a_filenames,
+        std::function<void(std::size_t, char const*, std::size_t)> a_data_callback
+    )
+    -> void;
+    /**
+     * @brief Uploads a local file without copying it through user space.
+     *
+     * @param[in] a_filename
+     * @param[in] a_local_path
+     *
+     * @throws std::system_error If a_local_path cannot be opened
+     * @throws std::runtime_error If parsing the PASV response fails
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or data transfer
+     * connection fails.
+     */
+    auto upload(
+        std::string const& a_filename,
+        std::filesystem::path const& a_local_path
+    )
+    -> void;
+    /**
+     * @brief Uploads everything from the current offset of a_fd to its end.
+     *
+     * a_fd may be a pipe or a socket, which is read until its writer closes it.
+     *
+     * @param[in] a_filename
+     * @param[in] a_fd Not closed - the caller keeps ownership.
+     *
+     * @throws std::runtime_error If parsing the PASV response fails
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or data transfer
+     * connection fails.
+     */
+    auto upload(
+        std::string const& a_filename,
+        int a_fd
+    )
+    -> void;
     /**
      * @brief
      *
@@ -281,6 +704,63 @@ public:
      * @returns std::string
      */
     auto ls(std::string const& a_pathname) -> std::string;
+    /**
+     * @brief Complete LIST output of a directory, as sent by the server.
+     *
+     * @param[in] a_pathname
+     *
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or reading from
+     * the data transfer connection fails
+     *
+     * @returns std::string
+     */
+    auto list(std::string const& a_pathname) -> std::string;
+    /**
+     * @brief Structured listing of a directory.
+     *
+     * Uses MLSD, falling back to parsing the LIST output for the rest of the session when the
+     * server does not implement it.
+     *
+     * @param[in] a_pathname
+     *
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or reading from
+     * the data transfer connection fails
+     *
+     * @returns directory_listing
+     */
+    auto list_directory(std::string const& a_pathname) -> directory_listing;
+    /**
+     * @brief Streams the entries of a directory to a_entry_callback as they arrive.
+     *
+     * Only the unparsed tail of the data read so far is kept, so memory use does not grow with
+     * the size of the directory. The entry is valid only during the call.
+     *
+     * @param[in] a_pathname
+     * @param[in] a_entry_callback
+     *
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails or reading from
+     * the data transfer connection fails
+     */
+    auto list_directory(
+        std::string const& a_pathname,
+        std::function<void(listing_entry const&)> a_entry_callback
+    )
+    -> void;
+    /**
+     * @brief Size of a remote file in bytes (RFC3659 SIZE).
+     *
+     * @param[in] a_filepath
+     *
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws std::invalid_argument If the server returns a malformed response
+     * @throws boost::system::system_error If reading/writing to the socket fails
+     *
+     * @returns std::size_t
+     */
+    auto size(std::string const& a_filepath) -> std::size_t;
     /**
      * @brief
      *
@@ -301,6 +781,16 @@ public:
      * @returns std::string
      */
     auto progress() -> std::string;
+    /**
+     * @brief Extensions the server supports (RFC2389 FEAT) - "MLST type*;size*;", "REST STREAM",
+     * "UTF8" etc.
+     *
+     * @throws std::runtime_error If the server returns an unexpected response
+     * @throws boost::system::system_error If reading/writing to the socket fails
+     *
+     * @returns std::vector<std::string> Empty if the server does not implement FEAT.
+     */
+    auto features() -> std::vector<std::string>;
     /**
      * @brief
      *
@@ -308,33 +798,1172 @@ public:
      * @throws boost::system::system_error If reading/writing to the socket fails
      */
     auto noop() -> void;
+    /**
+     * @brief Whether the control connection is usable.
+     *
+     * Turns false once the server closes the control connection or replies with 421.
+     *
+     * @returns bool
+     */
+    auto is_open() noexcept -> bool;
+    /**
+     * @brief Pipelines the commands of a_batch and returns their replies in order.
+     *
+     * Commands are written in windows, so one round trip is paid per window instead of per command.
+     * A rejected command does not stop the batch - its command_reply holds the error.
+     *
+     * @param[in] a_batch
+     *
+     * @throws boost::system::system_error If reading/writing to the socket fails
+     *
+     * @returns std::vector<command_reply> One reply per command of a_batch.
+     */
+    auto execute(command_batch const& a_batch) -> std::vector<command_reply>;
 
-private:
     /**
-     * @brief
+     * @brief Asynchronous connect().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
      */
-    auto download_active(
-        std::string const& a_filename,
-        std::function<void(std::vector<char> const&)> a_data_callback
+    template <typename CompletionToken>
+    auto async_connect(CompletionToken&& a_token)
+    {
+        return async_connect(m_options.server_hostname, m_options.server_port, a_token);
+    }
+    /**
+     * @brief Asynchronous connect(a_hostname, a_port).
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_connect(
+        std::string const& a_hostname,
+        int a_port,
+        CompletionToken&& a_token
     )
-    -> void;
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_hostname, a_port](completion_handler a_handler) -> void
+            {
+                start_connect(a_hostname, a_port, std::move(a_handler));
+            }
+        );
+    }
     /**
-     * @brief
+     * @brief Asynchronous close().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
      */
-    auto download_passive(
-        std::string const& a_filename,
-        std::function<void(std::vector<char> const&)> a_data_callback
+    template <typename CompletionToken>
+    auto async_close(CompletionToken&& a_token)
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this](completion_handler a_handler) -> void
+            {
+                start_close(std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous login().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_login(CompletionToken&& a_token)
+    {
+        return async_login(m_options.username, m_options.password, a_token);
+    }
+    /**
+     * @brief Asynchronous login(a_username, a_password).
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_login(
+        std::string const& a_username,
+        std::string const& a_password,
+        CompletionToken&& a_token
     )
-    -> void;
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_username, a_password](completion_handler a_handler) -> void
+            {
+                start_login(a_username, a_password, std::move(a_handler));
+            }
+        );
+    }
     /**
-     * @brief
+     * @brief Asynchronous cwd().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
      */
-    auto enter_passive_mode(connection& a_data_transfer_connection)
-    -> void;
-
+    template <typename CompletionToken>
+    auto async_cwd(
+        std::string const& a_new_wd,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_new_wd](completion_handler a_handler) -> void
+            {
+                start_cwd(a_new_wd, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous cdup().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_cdup(CompletionToken&& a_token)
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this](completion_handler a_handler) -> void
+            {
+                start_cdup(std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous download(a_filename).
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::vector<char>)
+     */
+    template <typename CompletionToken>
+    auto async_download(
+        std::string const& a_filename,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, std::vector<char>>(
+            m_io_context,
+            a_token,
+            [this, a_filename](bytes_completion_handler a_handler) -> void
+            {
+                start_download(a_filename, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous download() to a sink.
+     *
+     * @param[in] a_sink Moved or copied into the operation - pass a std::reference_wrapper to
+     * keep using an existing one.
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <
+        typename Sink,
+        typename CompletionToken,
+        typename = std::enable_if_t<std::is_invocable_v<Sink&, char const*, std::size_t>>
+    >
+    auto async_download(
+        std::string const& a_filename,
+        Sink&& a_sink,
+        CompletionToken&& a_token
+    )
+    {
+        auto sink = std::make_shared<std::decay_t<Sink>>(std::forward<Sink>(a_sink));
+
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filename, sink](completion_handler a_handler) -> void
+            {
+                start_download_to_sink(
+                    a_filename,
+                    *sink,
+                    [sink, a_handler](std::exception_ptr a_error) -> void
+                    {
+                        a_handler(a_error);
+                    }
+                );
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous download() into caller owned memory.
+     *
+     * @param[in] a_buffer Must outlive the operation.
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::size_t)
+     */
+    template <typename CompletionToken>
+    auto async_download(
+        std::string const& a_filename,
+        char* a_buffer,
+        std::size_t a_size,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, std::size_t>(
+            m_io_context,
+            a_token,
+            [this, a_filename, a_buffer, a_size](size_completion_handler a_handler) -> void
+            {
+                start_download(a_filename, a_buffer, a_size, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous download(a_filename, a_ofstream).
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_download(
+        std::string const& a_filename,
+        std::ofstream& a_ofstream,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filename, &a_ofstream](completion_handler a_handler) -> void
+            {
+                start_download(a_filename, a_ofstream, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous download() into a local file.
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_download(
+        std::string const& a_filename,
+        std::filesystem::path const& a_local_path,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filename, a_local_path](completion_handler a_handler) -> void
+            {
+                start_download(a_filename, a_local_path, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous download() into a file descriptor.
+     *
+     * @param[in] a_fd Must stay open until the operation completes.
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_download(
+        std::string const& a_filename,
+        int a_fd,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filename, a_fd](completion_handler a_handler) -> void
+            {
+                start_download(a_filename, a_fd, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous download_files().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_download_files(
+        std::vector<std::string> const& a_filenames,
+        std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filenames, a_data_callback](completion_handler a_handler) -> void
+            {
+                start_download_files(a_filenames, a_data_callback, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous upload().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_upload(
+        std::string const& a_filename,
+        std::istream& a_istream,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filename, &a_istream](completion_handler a_handler) -> void
+            {
+                start_upload(a_filename, a_istream, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous upload() of a local file.
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_upload(
+        std::string const& a_filename,
+        std::filesystem::path const& a_local_path,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filename, a_local_path](completion_handler a_handler) -> void
+            {
+                start_upload(a_filename, a_local_path, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous upload() of a file descriptor.
+     *
+     * @param[in] a_fd Must stay open until the operation completes.
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_upload(
+        std::string const& a_filename,
+        int a_fd,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filename, a_fd](completion_handler a_handler) -> void
+            {
+                start_upload(a_filename, a_fd, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous rename().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_rename(
+        std::string const& a_file_to_rename,
+        std::string const& a_rename_to,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_file_to_rename, a_rename_to](completion_handler a_handler) -> void
+            {
+                start_rename(a_file_to_rename, a_rename_to, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous remove_file().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_remove_file(
+        std::string const& a_filepath,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_filepath](completion_handler a_handler) -> void
+            {
+                start_remove_file(a_filepath, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous rmdir().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_rmdir(
+        std::string const& a_dirpath,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_dirpath](completion_handler a_handler) -> void
+            {
+                start_rmdir(a_dirpath, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous mkdir().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_mkdir(
+        std::string const& a_dirpath,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_dirpath](completion_handler a_handler) -> void
+            {
+                start_mkdir(a_dirpath, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous pwd().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::string)
+     */
+    template <typename CompletionToken>
+    auto async_pwd(CompletionToken&& a_token)
+    {
+        return initiate_operation<CompletionToken, std::string>(
+            m_io_context,
+            a_token,
+            [this](string_completion_handler a_handler) -> void
+            {
+                start_pwd(std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous ls().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::string)
+     */
+    template <typename CompletionToken>
+    auto async_ls(CompletionToken&& a_token)
+    {
+        return async_ls(std::string{}, a_token);
+    }
+    /**
+     * @brief Asynchronous ls(a_pathname).
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::string)
+     */
+    template <typename CompletionToken>
+    auto async_ls(
+        std::string const& a_pathname,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, std::string>(
+            m_io_context,
+            a_token,
+            [this, a_pathname](string_completion_handler a_handler) -> void
+            {
+                start_ls(a_pathname, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous list().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::string)
+     */
+    template <typename CompletionToken>
+    auto async_list(
+        std::string const& a_pathname,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, std::string>(
+            m_io_context,
+            a_token,
+            [this, a_pathname](string_completion_handler a_handler) -> void
+            {
+                start_list(a_pathname, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous list_directory().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, directory_listing)
+     */
+    template <typename CompletionToken>
+    auto async_list_directory(
+        std::string const& a_pathname,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, directory_listing>(
+            m_io_context,
+            a_token,
+            [this, a_pathname](listing_completion_handler a_handler) -> void
+            {
+                start_list_directory(a_pathname, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous streaming list_directory().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_list_directory(
+        std::string const& a_pathname,
+        std::function<void(listing_entry const&)> a_entry_callback,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_pathname, a_entry_callback](completion_handler a_handler) -> void
+            {
+                start_list_directory(a_pathname, a_entry_callback, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous size().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::size_t)
+     */
+    template <typename CompletionToken>
+    auto async_size(
+        std::string const& a_filepath,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, std::size_t>(
+            m_io_context,
+            a_token,
+            [this, a_filepath](size_completion_handler a_handler) -> void
+            {
+                start_size(a_filepath, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous system_info().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::string)
+     */
+    template <typename CompletionToken>
+    auto async_system_info(CompletionToken&& a_token)
+    {
+        return initiate_operation<CompletionToken, std::string>(
+            m_io_context,
+            a_token,
+            [this](string_completion_handler a_handler) -> void
+            {
+                start_system_info(std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous progress().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::string)
+     */
+    template <typename CompletionToken>
+    auto async_progress(CompletionToken&& a_token)
+    {
+        return initiate_operation<CompletionToken, std::string>(
+            m_io_context,
+            a_token,
+            [this](string_completion_handler a_handler) -> void
+            {
+                start_progress(std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous features().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::vector<std::string>)
+     */
+    template <typename CompletionToken>
+    auto async_features(CompletionToken&& a_token)
+    {
+        return initiate_operation<CompletionToken, std::vector<std::string>>(
+            m_io_context,
+            a_token,
+            [this](features_completion_handler a_handler) -> void
+            {
+                start_features(std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous noop().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_noop(CompletionToken&& a_token)
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this](completion_handler a_handler) -> void
+            {
+                start_noop(std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous execute().
+     *
+     * @param[in] a_token Completion signature -
+     * void(std::exception_ptr, std::vector<command_reply>)
+     */
+    template <typename CompletionToken>
+    auto async_execute(
+        command_batch const& a_batch,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, std::vector<command_reply>>(
+            m_io_context,
+            a_token,
+            [this, a_batch](batch_completion_handler a_handler) -> void
+            {
+                start_execute(a_batch, std::move(a_handler));
+            }
+        );
+    }
+
 private:
+    auto start_connect(
+        std::string const& a_hostname,
+        int a_port,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_close(completion_handler a_handler) -> void;
+    auto start_login(
+        std::string const& a_username,
+        std::string const& a_password,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_cwd(
+        std::string const& a_new_wd,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_cdup(completion_handler a_handler) -> void;
+    auto start_download(
+        std::string const& a_filename,
+        bytes_completion_handler a_handler
+    )
+    -> void;
+    auto start_download(
+        std::string const& a_filename,
+        std::ofstream& a_ofstream,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_download(
+        std::string const& a_filename,
+        char* a_buffer,
+        std::size_t a_size,
+        size_completion_handler a_handler
+    )
+    -> void;
+    auto start_download(
+        std::string const& a_filename,
+        std::filesystem::path const& a_local_path,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_download(
+        std::string const& a_filename,
+        int a_fd,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_download_files(
+        std::vector<std::string> const& a_filenames,
+        std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Downloads file a_index of a_filenames and moves on to the next one.
+     */
+    auto download_next_file(
+        std::shared_ptr<std::vector<std::string> const> a_filenames,
+        std::size_t a_index,
+        std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Reads file a_index of a_filenames from its open data connection and moves on to the
+     * next one, whose data connection is opened while this one is still being read.
+     */
+    auto receive_files(
+        std::shared_ptr<std::vector<std::string> const> a_filenames,
+        std::size_t a_index,
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_upload(
+        std::string const& a_filename,
+        std::istream& a_istream,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_upload(
+        std::string const& a_filename,
+        std::filesystem::path const& a_local_path,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_upload(
+        std::string const& a_filename,
+        int a_fd,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_rename(
+        std::string const& a_file_to_rename,
+        std::string const& a_rename_to,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_remove_file(
+        std::string const& a_filepath,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_rmdir(
+        std::string const& a_dirpath,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_mkdir(
+        std::string const& a_dirpath,
+        completion_handler a_handler
+    )
+    -> void;
+    auto start_pwd(string_completion_handler a_handler) -> void;
+    auto start_ls(
+        std::string const& a_pathname,
+        string_completion_handler a_handler
+    )
+    -> void;
+    auto start_list(
+        std::string const& a_pathname,
+        string_completion_handler a_handler
+    )
+    -> void;
+    auto start_list_directory(
+        std::string const& a_pathname,
+        listing_completion_handler a_handler
+    )
+    -> void;
+    auto start_list_directory(
+        std::string const& a_pathname,
+        std::function<void(listing_entry const&)> a_entry_callback,
+        completion_handler a_handler
+    )
+    -> void;
+    using listing_transfer_handler = std::function<
+        void(std::exception_ptr, std::shared_ptr<connection>, bool)
+    >;
+    /**
+     * @brief Opens the data connection of a listing - MLSD, or LIST if the server lacks it.
+     *
+     * @param[in] a_handler Gets the data connection and whether it carries MLSD output.
+     */
+    auto start_listing_transfer(
+        std::string const& a_pathname,
+        listing_transfer_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Reads a MLSD/LIST listing from the data connection and parses it.
+     */
+    auto receive_listing(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        bool a_mlsd,
+        listing_completion_handler a_handler
+    )
+    -> void;
+    auto start_size(
+        std::string const& a_filepath,
+        size_completion_handler a_handler
+    )
+    -> void;
+    auto start_system_info(string_completion_handler a_handler) -> void;
+    auto start_progress(string_completion_handler a_handler) -> void;
+    auto start_features(features_completion_handler a_handler) -> void;
+    auto start_noop(completion_handler a_handler) -> void;
+    auto start_execute(
+        command_batch const& a_batch,
+        batch_completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Writes the next window of a batch and collects its replies.
+     */
+    auto execute_window(
+        std::shared_ptr<command_batch const> a_batch,
+        std::shared_ptr<std::vector<command_reply>> a_replies,
+        batch_completion_handler a_handler
+    )
+    -> void;
+    auto read_batch_reply(
+        std::shared_ptr<command_batch const> a_batch,
+        std::shared_ptr<std::vector<command_reply>> a_replies,
+        std::size_t a_window_end,
+        batch_completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Writes a command to the control connection and validates the reply.
+     */
+    auto send_command(
+        command_line const& a_command,
+        reply_code_set a_accepted_codes,
+        string_completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Reads a reply from the control connection without validating it.
+     */
+    auto read_raw_reply(string_completion_handler a_handler) -> void;
+    /**
+     * @brief Reads a reply from the control connection and validates it.
+     */
+    auto read_reply(
+        reply_code_set a_accepted_codes,
+        string_completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief
+     */
+    auto download_active(
+        std::string const& a_filename,
+        std::function<void(char const*, std::size_t)> a_data_callback
+    )
+    -> void;
+    /**
+     * @brief
+     */
+    auto download_passive(
+        std::string const& a_filename,
+        std::function<void(char const*, std::size_t)> a_data_callback,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Downloads a_length bytes starting at a_offset (REST + RETR).
+     *
+     * Used by session_pool::download_parallel, the data callback receives the absolute offset.
+     */
+    auto download_range(
+        std::string const& a_filename,
+        std::size_t a_offset,
+        std::size_t a_length,
+        std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Reads the data connection until the server closes it or a_remaining bytes are read.
+     *
+     * When the transfer is cut short the data connection is closed and the server's 426/451 reply
+     * is accepted as the end of the transfer.
+     */
+    auto receive_data(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::function<void(char const*, std::size_t)> a_data_callback,
+        std::size_t a_remaining,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief receive_data() reading into a_buf, which is reused for every chunk.
+     */
+    auto receive_data(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::shared_ptr<std::vector<char>> a_buf,
+        std::function<void(char const*, std::size_t)> a_data_callback,
+        std::size_t a_remaining,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Reads the data connection into a_buf until the server closes it, without reading the
+     *        transfer reply - the caller knows which replies are still owed.
+     */
+    auto receive_to_end(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::shared_ptr<std::vector<char>> a_buf,
+        std::function<void(char const*, std::size_t)> a_data_callback,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Drives the reactor until the operation started by a_start completes.
+     *
+     * @throws The error the operation completed with
+     */
+    auto run(std::function<void(completion_handler)> const& a_start) -> void;
+    /**
+     * @brief Opens the data connection of a RETR.
+     */
+    auto start_retrieve(
+        std::string const& a_filename,
+        data_connection_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Completes a download once reading the data connection failed with a_read_error.
+     *
+     * End of file is the end of a stream mode transfer - the transfer reply is read. Any other
+     * error aborts the transfer, whose reply is still read before the error is passed on.
+     */
+    auto finish_download(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::exception_ptr a_read_error,
+        completion_handler a_handler
+    )
+    -> void;
+    template <typename Sink>
+    auto start_download_to_sink(
+        std::string const& a_filename,
+        Sink& a_sink,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        start_retrieve(
+            a_filename,
+            [this, &a_sink, a_handler](
+                std::exception_ptr a_error,
+                std::shared_ptr<connection> a_data_transfer_connection
+            ) -> void
+            {
+                if (a_error)
+                {
+                    a_handler(a_error);
+                    return;
+                }
+
+                receive_to_sink(
+                    a_data_transfer_connection,
+                    std::make_shared<std::vector<char>>(65536),
+                    a_sink,
+                    a_handler
+                );
+            }
+        );
+    }
+    template <typename Sink>
+    auto receive_to_sink(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::shared_ptr<std::vector<char>> a_buf,
+        Sink& a_sink,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        a_data_transfer_connection->async_read_some(
+            a_buf->data(),
+            a_buf->size(),
+            [this, a_data_transfer_connection, a_buf, &a_sink, a_handler](
+                std::exception_ptr a_error,
+                std::size_t a_size
+            ) -> void
+            {
+                if (a_error)
+                {
+                    finish_download(a_data_transfer_connection, a_error, a_handler);
+                    return;
+                }
+
+                try
+                {
+                    a_sink(static_cast<char const*>(a_buf->data()), a_size);
+                } catch (...)
+                {
+                    abort_transfer(a_data_transfer_connection, std::current_exception(), a_handler);
+                    return;
+                }
+
+                receive_to_sink(a_data_transfer_connection, a_buf, a_sink, a_handler);
+            }
+        );
+    }
+    /**
+     * @brief Reads the data connection into a_buf until the server closes it or a_buf is full.
+     *
+     * Completes with the number of bytes in a_buf. Once the server closed the connection the
+     * transfer reply is read as well - a full buffer leaves both to the caller.
+     */
+    auto receive_into(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        char* a_buf,
+        std::size_t a_size,
+        std::size_t a_received,
+        size_completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Drops the data connection of a failed transfer, reads the transfer reply and reports
+     * a_error.
+     */
+    auto abort_transfer(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::exception_ptr a_error,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Uploads a_length bytes of the stream at a_offset of the remote file (REST + STOR).
+     *
+     * Used by session_pool::upload_parallel, a_started_handler is called once the server accepted
+     * the STOR - and therefore opened the file.
+     */
+    auto upload_range(
+        std::string const& a_filename,
+        std::istream& a_istream,
+        std::size_t a_offset,
+        std::size_t a_length,
+        completion_handler a_started_handler,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Writes the stream to the data connection until it is exhausted or a_remaining bytes
+     * are written. A stream that goes bad, or a failed write, aborts the transfer.
+     */
+    auto send_data(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::istream& a_istream,
+        std::shared_ptr<std::vector<char>> a_buf,
+        std::size_t a_remaining,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Closes the data connection of an upload and reads the transfer reply.
+     */
+    auto finish_upload(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        completion_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Opens a data connection and sends the transfer command on the control connection.
+     */
+    auto start_data_transfer(
+        command_line const& a_command,
+        data_connection_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Same as above, sending REST a_restart_offset before the transfer command.
+     */
+    auto start_data_transfer(
+        command_line const& a_command,
+        std::size_t a_restart_offset,
+        data_connection_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief A data connection, with the transfer_timeout deadline set.
+     */
+    auto make_data_connection() -> std::shared_ptr<connection>;
+    /**
+     * @brief Connects a data connection to the port of a_passive_mode_reply while sending the
+     *        transfer command, a_handler runs once both are done.
+     */
+    auto open_data_transfer(
+        std::string const& a_passive_mode_reply,
+        std::string a_command,
+        std::size_t a_restart_offset,
+        data_connection_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Sends REST a_restart_offset, unless it is 0, and the transfer command.
+     *
+     * @param[in] a_data_transfer_connection Passed on to a_handler.
+     */
+    auto send_transfer_command(
+        std::shared_ptr<connection> a_data_transfer_connection,
+        std::string a_command,
+        std::size_t a_restart_offset,
+        data_connection_handler a_handler
+    )
+    -> void;
+    /**
+     * @brief Sends EPSV, a_handler gets the reply.
+     */
+    auto enter_passive_mode(string_completion_handler a_handler) -> void;
+    /**
+     * @brief Same as above, for an EPSV that was already written - only reads its reply.
+     */
+    auto read_passive_mode_reply(string_completion_handler a_handler) -> void;
+    /**
+     * @brief Reads a_count replies, whatever they say - the ones still owed to commands that were
+     *        sent before a transfer failed. a_handler gets a_error.
+     */
+    auto skip_replies(
+        std::exception_ptr a_error,
+        std::size_t a_count,
+        completion_handler a_handler
+    )
+    -> void;
+
+private:
+    friend class session_pool;
+
     connection_options m_options;
+    // NOTE - Only set when the client is not given a reactor to run on.
+    std::unique_ptr<boost::asio::io_context> m_owned_io_context;
+    boost::asio::io_context& m_io_context;
     connection m_control_connection;
+    // NOTE - Set once the server rejected MLSD as not implemented.
+    bool m_mlsd_unsupported;
 };
 
 class end_of_file_error : public std::runtime_error
@@ -361,6 +1990,28 @@ public:
     { }
 };
 
+/**
+ * The server replied with a code the operation does not accept.
+ */
+class reply_error : public std::runtime_error
+{
+public:
+    reply_error(
+        std::string const& a_msg,
+        reply_code a_code
+    ) :
+        std::runtime_error(a_msg),
+        m_code(a_code)
+    { }
+
+    auto code() const noexcept -> reply_code
+    {
+        return m_code;
+    }
+
+private:
+    reply_code m_code;
+};
+
 }   // namespace ftp
 }   // namespace rs
-
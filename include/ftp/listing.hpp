@@ -0,0 +1,173 @@
+/**
+ * @file listing.hpp
+ */
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <string_view>
+
+
+namespace rs
+{
+namespace ftp
+{
+
+enum class entry_type
+{
+    FILE,
+    DIRECTORY,
+    SYMLINK,
+    OTHER,
+};
+
+/**
+ * A directory entry. The views point into the buffer of the directory_listing it came from.
+ */
+struct listing_entry
+{
+    std::string_view name{};
+    entry_type type{entry_type::OTHER};
+    std::optional<std::uint64_t> size{};
+    std::optional<std::chrono::system_clock::time_point> modify{};
+    // NOTE - MLSD perm fact ("adfrw") or the Unix mode string ("-rw-r--r--").
+    std::string_view permissions{};
+    // NOTE - MLSD unique fact, empty for LIST output.
+    std::string_view unique{};
+};
+
+/**
+ * Owns the raw listing and the entries parsed out of it. Move only - moving keeps the entries
+ * valid, copying would not.
+ */
+class directory_listing
+{
+public:
+    using const_iterator = std::vector<listing_entry>::const_iterator;
+
+    directory_listing() =default;
+    /**
+     * @brief
+     *
+     * @param[in] a_buffer Raw listing.
+     * @param[in] a_entries Entries pointing into a_buffer.
+     */
+    directory_listing(
+        std::vector<char> a_buffer,
+        std::vector<listing_entry> a_entries
+    ) :
+        m_buffer(std::move(a_buffer)),
+        m_entries(std::move(a_entries))
+    { }
+
+    directory_listing(directory_listing&&) noexcept =default;
+    directory_listing(directory_listing const&) =delete;
+
+    auto operator=(directory_listing&&) noexcept -> directory_listing& =default;
+    auto operator=(directory_listing const&) -> directory_listing& =delete;
+
+    auto begin() const noexcept -> const_iterator
+    {
+        return m_entries.begin();
+    }
+
+    auto end() const noexcept -> const_iterator
+    {
+        return m_entries.end();
+    }
+
+    auto size() const noexcept -> std::size_t
+    {
+        return m_entries.size();
+    }
+
+    auto empty() const noexcept -> bool
+    {
+        return m_entries.empty();
+    }
+
+    auto operator[](std::size_t a_index) const noexcept -> listing_entry const&
+    {
+        return m_entries[a_index];
+    }
+
+private:
+    std::vector<char> m_buffer;
+    std::vector<listing_entry> m_entries;
+};
+
+/**
+ * @brief Parses a RFC3659 MLSD/MLST line - "fact=value;fact=value; name".
+ *
+ * @param[in] a_line Without the line terminator.
+ * @param[out] a_entry
+ *
+ * @returns false for malformed lines and for the current/parent directory entries.
+ */
+auto parse_mlsd_line(
+    std::string_view a_line,
+    listing_entry& a_entry
+)
+noexcept -> bool;
+
+/**
+ * @brief Parses a LIST line in Unix "ls -l" or DOS/IIS format.
+ *
+ * Unix dates without a year are placed in the last twelve months.
+ *
+ * @param[in] a_line Without the line terminator.
+ * @param[out] a_entry
+ *
+ * @returns false for lines that are not entries - "total", ".", ".." etc.
+ */
+auto parse_list_line(
+    std::string_view a_line,
+    listing_entry& a_entry
+)
+noexcept -> bool;
+
+/**
+ * @brief Parses a single MLSD or LIST line.
+ *
+ * @param[in] a_line A trailing CR is ignored.
+ * @param[in] a_mlsd Whether a_line is MLSD output.
+ * @param[out] a_entry
+ *
+ * @returns false for lines that are not entries.
+ */
+auto parse_listing_line(
+    std::string_view a_line,
+    bool a_mlsd,
+    listing_entry& a_entry
+)
+noexcept -> bool;
+
+/**
+ * @brief Whether a name from a listing can be used as a single local path component.
+ *
+ * Names come from the server - empty names, ".", "..", names with a '/' or a '\', and on Windows
+ * names with a drive prefix ("C:") would reach outside the directory they are joined to.
+ *
+ * @param[in] a_name
+ */
+auto is_safe_entry_name(std::string_view a_name) noexcept -> bool;
+
+/**
+ * @brief Parses a whole MLSD or LIST listing, lines are separated by CRLF or LF.
+ *
+ * @param[in] a_buffer
+ * @param[in] a_mlsd Whether a_buffer holds MLSD output.
+ *
+ * @returns std::vector<listing_entry> Pointing into a_buffer.
+ */
+auto parse_listing(
+    std::vector<char> const& a_buffer,
+    bool a_mlsd
+)
+-> std::vector<listing_entry>;
+
+}   // namespace ftp
+}   // namespace rs
@@ -0,0 +1,325 @@
+/**
+ * @file session_pool.hpp
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <exception>
+#include <functional>
+
+#include <boost/asio/io_context.hpp>
+
+#include "ftp.hpp"
+#include "completion.hpp"
+
+
+namespace rs
+{
+namespace ftp
+{
+
+/**
+ * Keeps connected and logged in control sessions per (host, port, user), so callers do not pay
+ * for the connect/greeting/USER/PASS round trips before every transfer.
+ *
+ * Idle sessions are kept alive with NOOP. Sessions that hit EOF, get a 421 reply or fail the NOOP
+ * are evicted and replaced in the background. While sessions are idle the keepalive timer keeps
+ * the reactor busy. Same threading rules as rs::ftp::client apply.
+ */
+class session_pool
+{
+    struct impl;
+
+public:
+    /**
+     * A checked out session - returned to the pool on destruction.
+     */
+    class session
+    {
+    public:
+        session() =default;
+        session(session&& a_other) noexcept =default;
+        ~session() noexcept;
+
+        auto operator=(session&& a_other) noexcept -> session&;
+
+        auto operator*() const noexcept -> client&;
+        auto operator->() const noexcept -> client*;
+
+        explicit operator bool() const noexcept;
+
+        /**
+         * @brief Returns the session to the pool before the object is destroyed.
+         */
+        auto release() noexcept -> void;
+        /**
+         * @brief Drops the control connection and returns the session, so the pool replaces it.
+         *
+         * For sessions whose last operation failed half way - a reply may still be in flight.
+         */
+        auto discard() noexcept -> void;
+
+    private:
+        friend struct session_pool::impl;
+
+        session(
+            std::shared_ptr<session_pool::impl> a_pool,
+            std::string a_key,
+            std::shared_ptr<client> a_client
+        );
+
+        std::shared_ptr<session_pool::impl> m_pool;
+        std::string m_key;
+        std::shared_ptr<client> m_client;
+    };
+
+    /**
+     * @brief
+     *
+     * @param[in] a_io_context Reactor the sessions run on. Must outlive the pool.
+     * @param[in] a_sessions_per_endpoint Maximum sessions per (host, port, user).
+     * @param[in] a_keepalive_interval Idle time after which a session is sent a NOOP.
+     */
+    session_pool(
+        boost::asio::io_context& a_io_context,
+        std::size_t a_sessions_per_endpoint,
+        std::chrono::milliseconds a_keepalive_interval = std::chrono::milliseconds(30000)
+    );
+    ~session_pool() noexcept;
+
+    session_pool(session_pool const&) =delete;
+    auto operator=(session_pool const&) -> session_pool& =delete;
+
+    /**
+     * @brief Checks out a logged in session, connecting a new one if the endpoint has room.
+     *
+     * Blocks until a session is returned when all sessions of the endpoint are checked out.
+     *
+     * @param[in] a_opts
+     *
+     * @throws Whatever client::connect and client::login throw.
+     *
+     * @returns session
+     */
+    auto acquire(connection_options const& a_opts) -> session;
+    /**
+     * @brief Asynchronous acquire().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, session)
+     */
+    template <typename CompletionToken>
+    auto async_acquire(
+        connection_options const& a_opts,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, session>(
+            m_io_context,
+            a_token,
+            [this, a_opts](std::function<void(std::exception_ptr, session)> a_handler) -> void
+            {
+                start_acquire(a_opts, std::move(a_handler));
+            }
+        );
+    }
+    auto get_io_context() noexcept -> boost::asio::io_context&;
+    /**
+     * @brief Number of connected sessions, idle and checked out, for an endpoint.
+     *
+     * @param[in] a_opts
+     *
+     * @returns std::size_t
+     */
+    auto size(connection_options const& a_opts) const -> std::size_t;
+    /**
+     * @brief Number of keepalive NOOPs the server answered for an endpoint.
+     *
+     * @param[in] a_opts
+     *
+     * @returns std::size_t
+     */
+    auto keepalives(connection_options const& a_opts) const -> std::size_t;
+    /**
+     * @brief Downloads a file in a_segments byte ranges at the same time.
+     *
+     * The file is sized with SIZE and every range is fetched with REST + RETR over its own data
+     * connection and its own session of the pool. Ranges wait for a free session when the pool
+     * is smaller than a_segments.
+     *
+     * @param[in] a_opts
+     * @param[in] a_filename
+     * @param[in] a_segments
+     *
+     * @throws Whatever client::size and client::download throw - the first error of all ranges.
+     *
+     * @returns std::vector<char>
+     */
+    auto download_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::size_t a_segments
+    )
+    -> std::vector<char>;
+    /**
+     * @brief Same as above, writing every range at its offset of a_ofstream.
+     *
+     * @param[in] a_ofstream Must be seekable and outlive the operation.
+     */
+    auto download_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::ofstream& a_ofstream,
+        std::size_t a_segments
+    )
+    -> void;
+    /**
+     * @brief Asynchronous download_parallel(a_opts, a_filename, a_segments).
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr, std::vector<char>)
+     */
+    template <typename CompletionToken>
+    auto async_download_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::size_t a_segments,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken, std::vector<char>>(
+            m_io_context,
+            a_token,
+            [this, a_opts, a_filename, a_segments](
+                std::function<void(std::exception_ptr, std::vector<char>)> a_handler
+            ) -> void
+            {
+                start_download_parallel(a_opts, a_filename, a_segments, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous download_parallel(a_opts, a_filename, a_ofstream, a_segments).
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_download_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::ofstream& a_ofstream,
+        std::size_t a_segments,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_opts, a_filename, &a_ofstream, a_segments](
+                std::function<void(std::exception_ptr)> a_handler
+            ) -> void
+            {
+                start_download_parallel(
+                    a_opts,
+                    a_filename,
+                    a_ofstream,
+                    a_segments,
+                    std::move(a_handler)
+                );
+            }
+        );
+    }
+    /**
+     * @brief Uploads a local file in a_segments byte ranges at the same time.
+     *
+     * Every range is sent with REST + STOR over its own data connection and its own session of the
+     * pool. The first range truncates the remote file and the rest start once the server opened it.
+     * When the server refuses REST, or STOR at an offset, the file is uploaded again as a single
+     * stream once the ranges are done.
+     *
+     * @param[in] a_opts
+     * @param[in] a_filename Remote file.
+     * @param[in] a_local_path
+     * @param[in] a_segments
+     *
+     * @throws std::runtime_error If a_local_path can not be opened
+     * @throws Whatever client::upload throws - the first error of all ranges.
+     */
+    auto upload_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::string const& a_local_path,
+        std::size_t a_segments
+    )
+    -> void;
+    /**
+     * @brief Asynchronous upload_parallel().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_upload_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::string const& a_local_path,
+        std::size_t a_segments,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_opts, a_filename, a_local_path, a_segments](
+                std::function<void(std::exception_ptr)> a_handler
+            ) -> void
+            {
+                start_upload_parallel(
+                    a_opts,
+                    a_filename,
+                    a_local_path,
+                    a_segments,
+                    std::move(a_handler)
+                );
+            }
+        );
+    }
+
+private:
+    auto start_acquire(
+        connection_options const& a_opts,
+        std::function<void(std::exception_ptr, session)> a_handler
+    )
+    -> void;
+    auto start_download_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::size_t a_segments,
+        std::function<void(std::exception_ptr, std::vector<char>)> a_handler
+    )
+    -> void;
+    auto start_download_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::ofstream& a_ofstream,
+        std::size_t a_segments,
+        std::function<void(std::exception_ptr)> a_handler
+    )
+    -> void;
+    auto start_upload_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::string const& a_local_path,
+        std::size_t a_segments,
+        std::function<void(std::exception_ptr)> a_handler
+    )
+    -> void;
+
+private:
+    boost::asio::io_context& m_io_context;
+    std::shared_ptr<impl> m_impl;
+};
+
+}   // namespace ftp
+}   // namespace rs
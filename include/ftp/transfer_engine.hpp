@@ -0,0 +1,230 @@
+/**
+ * @file transfer_engine.hpp
+ */
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+
+#include "ftp.hpp"
+#include "completion.hpp"
+#include "session_pool.hpp"
+
+
+namespace rs
+{
+namespace ftp
+{
+
+struct transfer_job
+{
+    enum class direction
+    {
+        DOWNLOAD,
+        UPLOAD,
+    };
+
+    direction type{direction::DOWNLOAD};
+    std::string remote_path{};
+    std::string local_path{};
+    /**
+     * Called once the job is done - with the error if it failed.
+     */
+    std::function<void(std::exception_ptr)> on_complete{};
+    /**
+     * Size of the remote file when already known - from a listing. A download then skips SIZE.
+     */
+    std::optional<std::size_t> size{};
+};
+
+/**
+ * Runs download/upload jobs across the sessions of a session_pool.
+ *
+ * At most a_concurrency jobs run at a time. The sizes of the running jobs - transfer_job::size or
+ * SIZE for downloads, the local file size for uploads - are capped at a_max_in_flight_bytes, a
+ * job that does not fit waits for running jobs to finish without holding a session. Waiting jobs
+ * start in the order they asked, a job larger than the cap runs alone.
+ */
+class transfer_engine
+{
+    struct impl;
+
+public:
+    /**
+     * @brief
+     *
+     * @param[in] a_pool Must outlive the engine.
+     * @param[in] a_opts Server the jobs run against.
+     * @param[in] a_concurrency Maximum number of jobs running at the same time.
+     * @param[in] a_max_in_flight_bytes Cap on the total size of the running jobs.
+     */
+    transfer_engine(
+        session_pool& a_pool,
+        connection_options const& a_opts,
+        std::size_t a_concurrency,
+        std::size_t a_max_in_flight_bytes = std::numeric_limits<std::size_t>::max()
+    );
+    ~transfer_engine() noexcept;
+
+    transfer_engine(transfer_engine const&) =delete;
+    auto operator=(transfer_engine const&) -> transfer_engine& =delete;
+
+    /**
+     * @brief Queues a job. Jobs queued while the engine runs are picked up by the same run.
+     *
+     * @param[in] a_job
+     */
+    auto add(transfer_job a_job) -> void;
+    /**
+     * @brief Runs the queued jobs until all of them are done.
+     *
+     * A failed job does not stop the others.
+     *
+     * @throws transfer_error If any of the jobs failed
+     */
+    auto run() -> void;
+    /**
+     * @brief Copies a remote directory tree into a_local_dir.
+     *
+     * Directories are listed on the sessions of the pool as they are discovered, alongside the
+     * downloads of the files found so far. Queued jobs run as well.
+     *
+     * @param[in] a_remote_dir
+     * @param[in] a_local_dir Created if missing.
+     *
+     * @throws transfer_error If listing a directory or transferring a file failed
+     */
+    auto mirror_down(
+        std::string const& a_remote_dir,
+        std::string const& a_local_dir
+    )
+    -> void;
+    /**
+     * @brief Copies a local directory tree into a_remote_dir.
+     *
+     * The remote directories are created with one pipelined batch of MKD before the uploads start.
+     *
+     * @param[in] a_local_dir
+     * @param[in] a_remote_dir Created if missing.
+     *
+     * @throws std::filesystem::filesystem_error If walking a_local_dir fails
+     * @throws transfer_error If transferring a file failed
+     */
+    auto mirror_up(
+        std::string const& a_local_dir,
+        std::string const& a_remote_dir
+    )
+    -> void;
+    /**
+     * @brief Asynchronous run().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_run(CompletionToken&& a_token)
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this](std::function<void(std::exception_ptr)> a_handler) -> void
+            {
+                start_run(std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous mirror_down().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_mirror_down(
+        std::string const& a_remote_dir,
+        std::string const& a_local_dir,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_remote_dir, a_local_dir](std::function<void(std::exception_ptr)> a_handler)
+            -> void
+            {
+                start_mirror_down(a_remote_dir, a_local_dir, std::move(a_handler));
+            }
+        );
+    }
+    /**
+     * @brief Asynchronous mirror_up().
+     *
+     * @param[in] a_token Completion signature - void(std::exception_ptr)
+     */
+    template <typename CompletionToken>
+    auto async_mirror_up(
+        std::string const& a_local_dir,
+        std::string const& a_remote_dir,
+        CompletionToken&& a_token
+    )
+    {
+        return initiate_operation<CompletionToken>(
+            m_io_context,
+            a_token,
+            [this, a_local_dir, a_remote_dir](std::function<void(std::exception_ptr)> a_handler)
+            -> void
+            {
+                start_mirror_up(a_local_dir, a_remote_dir, std::move(a_handler));
+            }
+        );
+    }
+
+private:
+    auto start_run(std::function<void(std::exception_ptr)> a_handler) -> void;
+    auto start_mirror_down(
+        std::string const& a_remote_dir,
+        std::string const& a_local_dir,
+        std::function<void(std::exception_ptr)> a_handler
+    )
+    -> void;
+    auto start_mirror_up(
+        std::string const& a_local_dir,
+        std::string const& a_remote_dir,
+        std::function<void(std::exception_ptr)> a_handler
+    )
+    -> void;
+
+private:
+    boost::asio::io_context& m_io_context;
+    std::shared_ptr<impl> m_impl;
+};
+
+/**
+ * Errors of the failed jobs of a transfer_engine run.
+ */
+class transfer_error : public std::runtime_error
+{
+public:
+    using job_error = std::pair<transfer_job, std::exception_ptr>;
+
+    explicit transfer_error(std::vector<job_error> a_errors) :
+        std::runtime_error(std::to_string(a_errors.size()) + " transfer(s) failed"),
+        m_errors(std::move(a_errors))
+    { }
+
+    auto errors() const noexcept -> std::vector<job_error> const&
+    {
+        return m_errors;
+    }
+
+private:
+    std::vector<job_error> m_errors;
+};
+
+}   // namespace ftp
+}   // namespace rs
@@ -3,7 +3,12 @@
  */
 #pragma once
 
-#include <sstream>
+#include <array>
+#include <string>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
 
 #include <ftp/codes.hpp>
 
@@ -13,480 +18,369 @@ namespace rs
 namespace ftp
 {
 
-inline auto quit_command() noexcept -> std::string
-{
-    std::ostringstream ss;
+/**
+ * A command line kept as its parts - the verb and views of the arguments. It is written out
+ * straight into the send buffer of a connection, no string is built for it.
+ *
+ * @warning The arguments are not copied, they must outlive the write.
+ */
+class command_line
+{
+public:
+    explicit constexpr command_line(std::string_view a_verb) noexcept :
+        m_verb(a_verb)
+    { }
+
+    /**
+     * @brief Appends a_separator and a_argument.
+     */
+    constexpr auto argument(std::string_view a_argument, char a_separator = ' ') noexcept
+    -> command_line&
+    {
+        return add({a_separator, a_argument, 0, false});
+    }
 
-    ss << ftp_command_to_str(ftp_command::QUIT)
-       << CRLF;
-    return ss.str();
-}
+    constexpr auto argument(std::uint64_t a_argument, char a_separator = ' ') noexcept
+    -> command_line&
+    {
+        return add({a_separator, {}, a_argument, true});
+    }
 
-inline auto user_command(std::string const& a_username) noexcept -> std::string
-{
-    std::ostringstream ss;
+    /**
+     * @brief Appends the line, CRLF included, to a_buffer.
+     */
+    auto write_to(std::string& a_buffer) const -> void
+    {
+        a_buffer.append(m_verb);
+
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            auto const& part = m_parts[i];
+
+            a_buffer.push_back(part.separator);
+
+            if (part.is_number)
+            {
+                std::array<char, 20> digits{};
+                auto const end = std::to_chars(
+                    digits.data(),
+                    digits.data() + digits.size(),
+                    part.number
+                ).ptr;
+
+                a_buffer.append(digits.data(), end - digits.data());
+            } else
+            {
+                a_buffer.append(part.text);
+            }
+        }
+
+        a_buffer.append(CRLF);
+    }
 
-    ss << ftp_command_to_str(ftp_command::USER)
-       << SP
-       << a_username
-       << CRLF;
+    /**
+     * @brief The line without CRLF, for commands that have to outlive their arguments.
+     */
+    auto str() const -> std::string
+    {
+        std::string ret;
+        write_to(ret);
+        ret.resize(ret.size() - CRLF.size());
 
-    return ss.str();
-}
+        return ret;
+    }
 
-inline auto password_command(std::string const& a_password) noexcept -> std::string
-{
-    std::ostringstream ss;
+private:
+    struct part
+    {
+        char separator;
+        std::string_view text;
+        std::uint64_t number;
+        bool is_number;
+    };
 
-    ss << ftp_command_to_str(ftp_command::PASS)
-       << SP
-       << a_password
-       << CRLF;
+    // NOTE - PORT has the most arguments.
+    static constexpr std::size_t MAX_ARGUMENTS{6};
 
-    return ss.str();
-}
+    constexpr auto add(part a_part) noexcept -> command_line&
+    {
+        assert(m_size < MAX_ARGUMENTS && "too many command arguments");
 
-inline auto cwd_command(std::string const& a_new_wd) noexcept -> std::string
-{
-    std::ostringstream ss;
+        m_parts[m_size++] = a_part;
+        return *this;
+    }
 
-    ss << ftp_command_to_str(ftp_command::CWD)
-       << SP
-       << a_new_wd
-       << CRLF;
+    std::string_view m_verb;
+    std::array<part, MAX_ARGUMENTS> m_parts{};
+    std::size_t m_size{0};
+};
 
-    return ss.str();
+inline auto quit_command() noexcept -> command_line
+{
+    return command_line(ftp_command_to_str(ftp_command::QUIT));
 }
 
-inline auto cdup_command() noexcept -> std::string
+inline auto user_command(std::string_view a_username) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::CDUP)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::USER)).argument(a_username);
 }
 
-inline auto smnt_command(std::string const& a_mount_point) noexcept -> std::string
+inline auto password_command(std::string_view a_password) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::SMNT)
-       << SP
-       << a_mount_point
-       << CRLF;
+    return command_line(ftp_command_to_str(ftp_command::PASS)).argument(a_password);
+}
 
-    return ss.str();
+inline auto cwd_command(std::string_view a_new_wd) noexcept -> command_line
+{
+    return command_line(ftp_command_to_str(ftp_command::CWD)).argument(a_new_wd);
 }
 
-inline auto rein_command() noexcept -> std::string
+inline auto cdup_command() noexcept -> command_line
 {
-    std::ostringstream ss;
+    return command_line(ftp_command_to_str(ftp_command::CDUP));
+}
 
-    ss << ftp_command_to_str(ftp_command::REIN)
-       << CRLF;
+inline auto smnt_command(std::string_view a_mount_point) noexcept -> command_line
+{
+    return command_line(ftp_command_to_str(ftp_command::SMNT)).argument(a_mount_point);
+}
 
-    return ss.str();
+inline auto rein_command() noexcept -> command_line
+{
+    return command_line(ftp_command_to_str(ftp_command::REIN));
 }
 
 inline auto port_command(
-    std::string const& a_h1,
-    std::string const& a_h2,
-    std::string const& a_h3,
-    std::string const& a_h4,
-    std::string const& a_p1,
-    std::string const& a_p2
-) noexcept
--> std::string
+    std::string_view a_h1,
+    std::string_view a_h2,
+    std::string_view a_h3,
+    std::string_view a_h4,
+    std::string_view a_p1,
+    std::string_view a_p2
+)
+noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::PORT)
-       << SP
-       << a_h1
-       << COMMA
-       << a_h2
-       << COMMA
-       << a_h3
-       << COMMA
-       << a_h4
-       << COMMA
-       << a_p1
-       << COMMA
-       << a_p2
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::PORT))
+        .argument(a_h1)
+        .argument(a_h2, COMMA.front())
+        .argument(a_h3, COMMA.front())
+        .argument(a_h4, COMMA.front())
+        .argument(a_p1, COMMA.front())
+        .argument(a_p2, COMMA.front());
 }
 
-inline auto pasv_command() noexcept -> std::string
+inline auto pasv_command() noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::PASV)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::PASV));
 }
 
-inline auto type_command(data_type a_data_type) noexcept -> std::string
+inline auto type_command(data_type a_data_type) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::TYPE)
-       << SP
-       << data_type_to_str(a_data_type)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::TYPE))
+        .argument(data_type_to_str(a_data_type));
 }
 
-inline auto stru_command(file_structure a_structure) noexcept -> std::string
+inline auto stru_command(file_structure a_structure) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::STRU)
-       << SP
-       << file_structure_to_str(a_structure)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::STRU))
+        .argument(file_structure_to_str(a_structure));
 }
 
-inline auto mode_command(transmission_mode a_mode) noexcept -> std::string
+inline auto mode_command(transmission_mode a_mode) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::MODE)
-       << SP
-       << transmission_mode_to_str(a_mode)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::MODE))
+        .argument(transmission_mode_to_str(a_mode));
 }
 
-inline auto retr_command(std::string const& a_filename) noexcept -> std::string
+inline auto retr_command(std::string_view a_filename) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::RETR)
-       << SP
-       << a_filename
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::RETR)).argument(a_filename);
 }
 
-inline auto stor_command(std::string const& a_filename) noexcept -> std::string
+inline auto stor_command(std::string_view a_filename) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::STOR)
-       << SP
-       << a_filename
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::STOR)).argument(a_filename);
 }
 
-inline auto appe_command(std::string const& a_filename) noexcept -> std::string
+inline auto appe_command(std::string_view a_filename) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::APPE)
-       << SP
-       << a_filename
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::APPE)).argument(a_filename);
 }
 
-inline auto allo_command(int a_bytes_to_reserve) noexcept -> std::string
+inline auto allo_command(int a_bytes_to_reserve) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::ALLO)
-       << SP
-       << a_bytes_to_reserve
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::ALLO))
+        .argument(static_cast<std::uint64_t>(a_bytes_to_reserve));
 }
 
-inline auto allo_command(int a_bytes_to_reserve, int a_max_record_or_page_size) noexcept -> std::string
+inline auto allo_command(
+    int a_bytes_to_reserve,
+    int a_max_record_or_page_size
+)
+noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::ALLO)
-       << SP
-       << a_bytes_to_reserve
-       << SP
-       << 'R'
-       << SP
-       << a_max_record_or_page_size
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::ALLO))
+        .argument(static_cast<std::uint64_t>(a_bytes_to_reserve))
+        .argument("R")
+        .argument(static_cast<std::uint64_t>(a_max_record_or_page_size));
 }
 
-inline auto rnfr_command(std::string const& a_file_to_rename) noexcept -> std::string
+inline auto rest_command(std::size_t a_marker) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::RNFR)
-       << SP
-       << a_file_to_rename
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::REST)).argument(a_marker);
 }
 
-inline auto rnto_command(std::string const& a_rename_to) noexcept -> std::string
+inline auto rnfr_command(std::string_view a_file_to_rename) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::RNTO)
-       << SP
-       << a_rename_to
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::RNFR)).argument(a_file_to_rename);
 }
 
-inline auto dele_command(std::string const& a_filepath) noexcept -> std::string
+inline auto rnto_command(std::string_view a_rename_to) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::DELE)
-       << SP
-       << a_filepath
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::RNTO)).argument(a_rename_to);
 }
 
-inline auto rmd_command(std::string const& a_dirpath) noexcept -> std::string
+inline auto dele_command(std::string_view a_filepath) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::RMD)
-       << SP
-       << a_dirpath
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::DELE)).argument(a_filepath);
 }
 
-inline auto mkd_command(std::string const& a_dirpath) noexcept -> std::string
+inline auto rmd_command(std::string_view a_dirpath) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::MKD)
-       << SP
-       << a_dirpath
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::RMD)).argument(a_dirpath);
 }
 
-inline auto pwd_command() noexcept -> std::string
+inline auto mkd_command(std::string_view a_dirpath) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::PWD)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::MKD)).argument(a_dirpath);
 }
 
-inline auto list_command(std::string const& a_pathname = {}) noexcept -> std::string
+inline auto pwd_command() noexcept -> command_line
 {
-    std::ostringstream ss;
+    return command_line(ftp_command_to_str(ftp_command::PWD));
+}
 
-    ss << ftp_command_to_str(ftp_command::LIST);
+inline auto list_command(std::string_view a_pathname = {}) noexcept -> command_line
+{
+    command_line command(ftp_command_to_str(ftp_command::LIST));
 
     if (!a_pathname.empty())
     {
-        ss << SP;
-        ss << a_pathname;
+        command.argument(a_pathname);
     }
 
-    ss << CRLF;
-
-    return ss.str();
+    return command;
 }
 
-inline auto nlst_command(std::string const& a_pathname = {}) noexcept -> std::string
+inline auto nlst_command(std::string_view a_pathname = {}) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::NLST);
+    command_line command(ftp_command_to_str(ftp_command::NLST));
 
     if (!a_pathname.empty())
     {
-        ss << SP;
-        ss << a_pathname;
+        command.argument(a_pathname);
     }
 
-    ss << CRLF;
-
-    return ss.str();
+    return command;
 }
 
-inline auto syst_command() noexcept -> std::string
+inline auto syst_command() noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::SYST)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::SYST));
 }
 
-inline auto stat_command(std::string const& a_pathname = {}) noexcept -> std::string
+inline auto stat_command(std::string_view a_pathname = {}) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::STAT);
+    command_line command(ftp_command_to_str(ftp_command::STAT));
 
     if (!a_pathname.empty())
     {
-        ss << SP;
-        ss << a_pathname;
+        command.argument(a_pathname);
     }
 
-    ss << CRLF;
-
-    return ss.str();
+    return command;
 }
 
-inline auto noop_command() noexcept -> std::string
+inline auto noop_command() noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::NOOP)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::NOOP));
 }
 
-inline auto auth_command(authentication_method a_auth_method) noexcept -> std::string
+inline auto auth_command(authentication_method a_auth_method) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::AUTH)
-       << SP
-       << authentication_method_to_str(a_auth_method)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::AUTH))
+        .argument(authentication_method_to_str(a_auth_method));
 }
 
-inline auto adat_command(std::string const& a_data) noexcept -> std::string
+inline auto adat_command(std::string_view a_data) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::ADAT)
-       << SP
-       << a_data
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::ADAT)).argument(a_data);
 }
 
-inline auto pbsz_command(int a_size) noexcept -> std::string
+inline auto pbsz_command(int a_size) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::PBSZ)
-       << SP
-       << a_size
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::PBSZ))
+        .argument(static_cast<std::uint64_t>(a_size));
 }
 
-inline auto ccc_command() noexcept -> std::string
+inline auto ccc_command() noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::CCC)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::CCC));
 }
 
-inline auto prot_command(data_channel_protection_level a_protection_level) noexcept -> std::string
+inline auto prot_command(data_channel_protection_level a_protection_level) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::PROT)
-       << SP
-       << data_channel_protection_level_to_str(a_protection_level)
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::PROT))
+        .argument(data_channel_protection_level_to_str(a_protection_level));
 }
 
-inline auto mic_command(std::string const& a_data) noexcept -> std::string
+inline auto mic_command(std::string_view a_data) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::MIC)
-       << SP
-       << a_data
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::MIC)).argument(a_data);
 }
 
-inline auto conf_command(std::string const& a_data) noexcept -> std::string
+inline auto conf_command(std::string_view a_data) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::CONF)
-       << SP
-       << a_data
-       << CRLF;
-
-    return ss.str();
+    return command_line(ftp_command_to_str(ftp_command::CONF)).argument(a_data);
 }
 
-inline auto enc_command(std::string const& a_data) noexcept -> std::string
+inline auto enc_command(std::string_view a_data) noexcept -> command_line
 {
-    std::ostringstream ss;
-
-    ss << ftp_command_to_str(ftp_command::ENC)
-       << SP
-       << a_data
-       << CRLF;
+    return command_line(ftp_command_to_str(ftp_command::ENC)).argument(a_data);
+}
 
-    return ss.str();
+inline auto epsv_command() noexcept -> command_line
+{
+    return command_line(ftp_command_to_str(ftp_command::EPSV));
 }
 
-inline auto epsv_command() noexcept -> std::string
+inline auto epsv_command(address_family a_af) noexcept -> command_line
 {
-    std::ostringstream ss;
+    return command_line(ftp_command_to_str(ftp_command::EPSV))
+        .argument(address_family_to_str(a_af));
+}
 
-    ss << ftp_command_to_str(ftp_command::EPSV)
-       << CRLF;
+inline auto feat_command() noexcept -> command_line
+{
+    return command_line(ftp_command_to_str(ftp_command::FEAT));
+}
 
-    return ss.str();
+inline auto size_command(std::string_view a_pathname) noexcept -> command_line
+{
+    return command_line(ftp_command_to_str(ftp_command::SIZE)).argument(a_pathname);
 }
 
-inline auto epsv_command(address_family a_af) noexcept -> std::string
+inline auto mlsd_command(std::string_view a_pathname = {}) noexcept -> command_line
 {
-    std::ostringstream ss;
+    command_line command(ftp_command_to_str(ftp_command::MLSD));
 
-    ss << ftp_command_to_str(ftp_command::EPSV)
-       << SP
-       << address_family_to_str(a_af)
-       << CRLF;
+    if (!a_pathname.empty())
+    {
+        command.argument(a_pathname);
+    }
 
-    return ss.str();
+    return command;
 }
 
 }   // namespace ftp
 }   // namespace rs
-
@@ -1,10 +1,30 @@
 #include <ftp/ftp.hpp>
 
+#include <map>
+#include <new>
+#include <mutex>
+#include <limits>
+#include <utility>
+#include <optional>
 #include <cassert>
+#include <cerrno>
 #include <algorithm>
+#include <string_view>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 
 #include <boost/asio.hpp>
-#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 #include "util.hpp"
 #include "logger.hpp"
@@ -16,18 +36,156 @@ namespace rs
 namespace ftp
 {
 
-struct client::connection::impl
+/**
+ * Resolved control connection endpoints, shared by all clients in the process.
+ *
+ * The system resolver does not report record TTLs, an entry lives for the TTL of the
+ * connection_options it was resolved with.
+ */
+class resolve_cache
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using results_type = boost::asio::ip::tcp::resolver::results_type;
+
+    static auto instance() -> resolve_cache&
+    {
+        static resolve_cache cache;
+        return cache;
+    }
+
+    auto find(
+        std::string const& a_hostname,
+        int a_port
+    )
+    -> std::optional<results_type>
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto const it = m_entries.find({a_hostname, a_port});
+
+        if (it == m_entries.end())
+        {
+            return std::nullopt;
+        }
+
+        if (clock::now() >= it->second.expiry)
+        {
+            m_entries.erase(it);
+            return std::nullopt;
+        }
+
+        return it->second.results;
+    }
+
+    auto insert(
+        std::string const& a_hostname,
+        int a_port,
+        results_type a_results,
+        std::chrono::seconds a_ttl
+    )
+    -> void
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries[{a_hostname, a_port}] = entry{std::move(a_results), clock::now() + a_ttl};
+    }
+
+    // NOTE - Called when none of the cached endpoints accepted, the host may have moved.
+    auto erase(
+        std::string const& a_hostname,
+        int a_port
+    )
+    -> void
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.erase({a_hostname, a_port});
+    }
+
+private:
+    struct entry
+    {
+        results_type results;
+        clock::time_point expiry;
+    };
+
+    std::mutex m_mutex;
+    std::map<std::pair<std::string, int>, entry> m_entries;
+};
+
+struct client::connection::impl : public std::enable_shared_from_this<client::connection::impl>
 {
-    boost::asio::io_context m_io_context;
+    using clock = std::chrono::steady_clock;
+
+    // NOTE - Bytes a zero-copy loop moves before it lets the other handlers of the reactor run.
+    static constexpr std::uint64_t ZERO_COPY_BUDGET{8 << 20};
+    // NOTE - A count of async_send_file that sends up to the end of the file, however long.
+    static constexpr std::uint64_t UNTIL_END{std::numeric_limits<std::uint64_t>::max()};
+
+    struct connect_race;
+
+    // NOTE - What is left to send of a file.
+    struct file_range
+    {
+        int fd;
+        std::uint64_t offset;
+        std::uint64_t remaining;
+        // NOTE - remaining is not a count to check against - the file is sent to its end.
+        bool until_end;
+        // NOTE - Read at offset with pread, otherwise from the current position with read.
+        bool seekable;
+
+        auto advance(std::uint64_t a_sent) -> void
+        {
+            offset += a_sent;
+
+            if (!until_end)
+            {
+                remaining -= a_sent;
+            }
+        }
+
+        auto done() const -> bool
+        {
+            return !until_end && remaining == 0;
+        }
+    };
+
+    boost::asio::io_context& m_io_context;
+    boost::asio::ip::tcp::resolver m_resolver;
     boost::asio::ip::tcp::socket m_socket;
-    boost::asio::deadline_timer m_timer;
-    boost::system::error_code m_ec;
+    boost::asio::steady_timer m_timer;
     std::chrono::milliseconds m_timeout;
+    // NOTE - Operations still running past it fail however long they have been idle.
+    clock::time_point m_deadline;
+    // NOTE - When the running operation started.
+    clock::time_point m_operation_start;
+    // NOTE - Bumped whenever the timer is armed or cancelled, so stale expiries are ignored.
+    std::uint64_t m_timer_generation;
+    bool m_timer_armed;
+    bool m_in_operation;
+    bool m_timed_out;
+    // NOTE - Receive buffer of the connection, kept for its lifetime. Replies are cut off its
+    //        front as soon as they are complete, whatever was received past them - pipelined
+    //        replies, or data read along with the last reply - stays for the next read.
+    std::string m_read_buffer;
+    std::string m_write_buffer;
+    // NOTE - Only used when the file cannot be handed to sendfile(2).
+    std::vector<char> m_file_buffer;
+    // NOTE - Attempts of the connect in progress, if any.
+    std::shared_ptr<connect_race> m_race;
+    socket_options m_socket_options;
 
-    impl() :
+    impl(boost::asio::io_context& a_io_context) :
+        m_io_context(a_io_context),
+        m_resolver(m_io_context),
         m_socket(m_io_context),
         m_timer(m_io_context),
-        m_timeout(60000)
+        m_timeout(60000),
+        m_deadline(clock::time_point::max()),
+        m_operation_start(),
+        m_timer_generation(0),
+        m_timer_armed(false),
+        m_in_operation(false),
+        m_timed_out(false)
     { }
 
     ~impl() noexcept
@@ -44,820 +202,4148 @@ struct client::connection::impl
         }
     }
 
-    auto run_event_loop() -> void
+    auto make_error(boost::system::error_code const& a_ec) -> std::exception_ptr
+    {
+        if (m_timed_out || a_ec == boost::asio::error::timed_out)
+        {
+            m_timed_out = false;
+
+            boost::system::error_code timeout_ec = boost::asio::error::timed_out;
+            return std::make_exception_ptr(timeout_error(timeout_ec.message()));
+        } else if (a_ec == boost::asio::error::eof)
+        {
+            return std::make_exception_ptr(end_of_file_error(a_ec.message()));
+        } else
+        {
+            return std::make_exception_ptr(std::runtime_error(a_ec.message()));
+        }
+    }
+
+    template <typename Handler, typename Exception>
+    auto post_error(Handler a_handler, Exception const& a_exception) -> void
+    {
+        boost::asio::post(
+            m_io_context,
+            [a_handler, error = std::make_exception_ptr(a_exception)]() -> void
+            {
+                if constexpr (std::is_invocable_v<Handler, std::exception_ptr>)
+                {
+                    a_handler(error);
+                } else
+                {
+                    a_handler(error, {});
+                }
+            }
+        );
+    }
+
+    /**
+     * Ends a timed operation when it goes out of scope - after the completion handler ran. The
+     * timer is left armed if the handler started the next operation, so the read/write loop of a
+     * transfer does not cancel and re-arm it for every chunk.
+     */
+    class [[ nodiscard ]] operation_end
+    {
+    public:
+        explicit operation_end(impl& a_impl) noexcept :
+            m_impl(a_impl)
+        { }
+
+        ~operation_end() noexcept
+        {
+            m_impl.cancel_idle_timer();
+        }
+
+        operation_end(operation_end const&) =delete;
+        auto operator=(operation_end const&) -> operation_end& =delete;
+
+    private:
+        impl& m_impl;
+    };
+
+    auto expiry() const noexcept -> clock::time_point
+    {
+        return std::min(m_operation_start + m_timeout, m_deadline);
+    }
+
+    auto start_timer() -> void
+    {
+        m_timed_out = false;
+        m_in_operation = true;
+        m_operation_start = clock::now();
+
+        // NOTE - An armed timer expires no later than the new expiry, it is re-armed then.
+        if (!m_timer_armed)
+        {
+            arm_timer();
+        }
+    }
+
+    auto stop_timer() noexcept -> operation_end
     {
-        m_io_context.reset();
-        m_io_context.run();
+        m_in_operation = false;
+        rearm_quick_ack();
+        return operation_end(*this);
     }
 
-    auto handle_error() -> void
+    auto arm_timer() -> void
     {
-        if (m_ec)
+        m_timer_armed = true;
+        m_timer.expires_at(expiry());
+        m_timer.async_wait([self = shared_from_this(), generation = ++m_timer_generation](
+            boost::system::error_code const& a_ec
+        ) -> void
         {
-            auto ec = m_ec;
+            // NOTE - Cancelled, or cancelled and re-armed before this handler got to run.
+            if (a_ec || generation != self->m_timer_generation)
+            {
+                return;
+            }
 
-            m_ec = boost::system::error_code();
+            self->m_timer_armed = false;
 
-            if (ec == boost::asio::error::timed_out)
+            if (!self->m_in_operation)
             {
-                throw timeout_error(ec.message());
-            } else if (ec == boost::asio::error::eof)
+                return;
+            }
+
+            if (clock::now() < self->expiry())
             {
-                throw end_of_file_error(ec.message());
-            } else
+                self->arm_timer();
+                return;
+            }
+
+            boost::system::error_code ignored_ec;
+            self->m_timed_out = true;
+            self->m_resolver.cancel();
+            self->m_socket.cancel(ignored_ec);
+
+            if (self->m_race)
             {
-                throw std::runtime_error(ec.message());
+                self->m_race->cancel();
             }
+        });
+    }
+
+    auto cancel_idle_timer() noexcept -> void
+    {
+        if (m_in_operation || !m_timer_armed)
+        {
+            return;
         }
+
+        boost::system::error_code ignored_ec;
+        m_timer_armed = false;
+        ++m_timer_generation;
+        m_timer.cancel(ignored_ec);
     }
 
-    auto start_timer() -> void
+    auto set_deadline(clock::time_point a_deadline) noexcept -> void
+    {
+        m_deadline = a_deadline;
+    }
+
+    auto set_socket_options(socket_options const& a_options) noexcept -> void
+    {
+        m_socket_options = a_options;
+    }
+
+    static auto set_option(
+        boost::asio::ip::tcp::socket& a_socket,
+        int a_level,
+        int a_name,
+        int a_value,
+        std::string_view a_option_name
+    )
+    noexcept -> void
+    {
+        if (::setsockopt(a_socket.native_handle(), a_level, a_name, &a_value, sizeof(a_value)) < 0)
+        {
+            logger::warning(
+                std::string("Failed to set ") + std::string(a_option_name) + ": " +
+                std::error_code(errno, std::system_category()).message()
+            );
+        }
+    }
+
+    // NOTE - Before the connect, the buffer sizes decide the window scale the SYN announces.
+    auto apply_socket_options(boost::asio::ip::tcp::socket& a_socket) const noexcept -> void
     {
-        m_timer.cancel();
-        m_timer.expires_from_now(boost::posix_time::milliseconds(m_timeout.count()));
-        m_timer.async_wait([this](boost::system::error_code const& a_ec) -> void
+        auto const& options = m_socket_options;
+        boost::system::error_code ignored_ec;
+        auto const v6{a_socket.local_endpoint(ignored_ec).address().is_v6()};
+
+        if (options.no_delay)
+        {
+            set_option(a_socket, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+        }
+
+        if (options.receive_buffer_size > 0)
+        {
+            set_option(a_socket, SOL_SOCKET, SO_RCVBUF, options.receive_buffer_size, "SO_RCVBUF");
+        }
+
+        if (options.send_buffer_size > 0)
+        {
+            set_option(a_socket, SOL_SOCKET, SO_SNDBUF, options.send_buffer_size, "SO_SNDBUF");
+        }
+
+        if (options.keep_alive)
         {
-            // NOTE - Timer timed out.
-            if (!a_ec)
+            set_option(a_socket, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+            if (options.keep_alive_idle.count() > 0)
             {
-                boost::system::error_code ignored_ec;
-                m_socket.cancel(ignored_ec);
-                m_ec = boost::asio::error::timed_out;
-            } else if (a_ec && a_ec != boost::asio::error::operation_aborted)
+                auto const idle{static_cast<int>(options.keep_alive_idle.count())};
+                set_option(a_socket, IPPROTO_TCP, TCP_KEEPIDLE, idle, "TCP_KEEPIDLE");
+            }
+
+            if (options.keep_alive_interval.count() > 0)
             {
-                m_ec = a_ec;
+                auto const interval{static_cast<int>(options.keep_alive_interval.count())};
+                set_option(a_socket, IPPROTO_TCP, TCP_KEEPINTVL, interval, "TCP_KEEPINTVL");
             }
 
-            // NOTE - Timer got closed by operation completed in time/error in operation.
-        });
+            if (options.keep_alive_count > 0)
+            {
+                auto const count{options.keep_alive_count};
+                set_option(a_socket, IPPROTO_TCP, TCP_KEEPCNT, count, "TCP_KEEPCNT");
+            }
+#endif
+        }
+
+        if (auto const tos{options.type_of_service}; tos >= 0)
+        {
+            if (v6)
+            {
+                set_option(a_socket, IPPROTO_IPV6, IPV6_TCLASS, tos, "IPV6_TCLASS");
+            } else
+            {
+                set_option(a_socket, IPPROTO_IP, IP_TOS, tos, "IP_TOS");
+            }
+        }
+
+#if defined(SO_BUSY_POLL)
+        if (options.busy_poll.count() > 0)
+        {
+            auto const busy_poll{static_cast<int>(options.busy_poll.count())};
+            set_option(a_socket, SOL_SOCKET, SO_BUSY_POLL, busy_poll, "SO_BUSY_POLL");
+        }
+#endif
+    }
+
+    // NOTE - The kernel leaves quick ACK mode on its own, so it is switched back on after every
+    //        operation rather than once.
+    auto rearm_quick_ack() noexcept -> void
+    {
+#if defined(TCP_QUICKACK)
+        if (m_socket_options.quick_ack && m_socket.is_open())
+        {
+            int const one{1};
+            ::setsockopt(m_socket.native_handle(), IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+        }
+#endif
     }
 
-    auto connect(
+    auto async_connect(
         std::string const& a_hostname,
         int a_port,
-        std::chrono::milliseconds const& a_timeout
+        connection_options const& a_options,
+        completion_handler a_handler
     )
     -> void
     {
-        m_timeout = a_timeout;
-
         if (a_port < 0 || a_hostname.empty())
         {
             assert(false && "negative port number or empty hostname");
-            throw std::invalid_argument("Negative port number or empty hostname");
+            post_error(a_handler, std::invalid_argument("Negative port number or empty hostname"));
+            return;
         }
 
         if (m_socket.is_open())
         {
             assert(false && "already connected");
-            throw std::invalid_argument("Already connected");
+            post_error(a_handler, std::invalid_argument("Already connected"));
+            return;
+        }
+
+        m_read_buffer.clear();
+        m_timeout = a_options.connect_timeout;
+
+        auto const ttl{a_options.resolve_cache_ttl};
+        auto const attempt_delay{a_options.connect_attempt_delay};
+        auto const timeout{a_options.timeout};
+
+        if (ttl.count() > 0)
+        {
+            if (auto results = resolve_cache::instance().find(a_hostname, a_port))
+            {
+                start_timer();
+                connect_resolved(
+                    *results,
+                    attempt_delay,
+                    [self = shared_from_this(), a_hostname, a_port, ttl, attempt_delay, timeout,
+                     a_handler](std::exception_ptr a_error) -> void
+                    {
+                        if (!a_error)
+                        {
+                            self->m_timeout = timeout;
+                            a_handler(nullptr);
+                            return;
+                        }
+
+                        resolve_cache::instance().erase(a_hostname, a_port);
+
+                        // NOTE - The host may have moved, but a timeout already spent the budget.
+                        try
+                        {
+                            std::rethrow_exception(a_error);
+                        } catch (timeout_error const&)
+                        {
+                            self->m_timeout = timeout;
+                            a_handler(a_error);
+                            return;
+                        } catch (...)
+                        { }
+
+                        self->resolve_and_connect(
+                            a_hostname,
+                            a_port,
+                            ttl,
+                            attempt_delay,
+                            timeout,
+                            a_handler
+                        );
+                    }
+                );
+                return;
+            }
         }
 
-        boost::asio::ip::tcp::resolver resolver(m_io_context);
-        boost::asio::ip::tcp::resolver::query query(
+        resolve_and_connect(a_hostname, a_port, ttl, attempt_delay, timeout, a_handler);
+    }
+
+    // NOTE - Expects m_timeout to be the connect timeout, a_timeout is restored once it completed.
+    auto resolve_and_connect(
+        std::string const& a_hostname,
+        int a_port,
+        std::chrono::seconds a_ttl,
+        std::chrono::milliseconds a_attempt_delay,
+        std::chrono::milliseconds a_timeout,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        start_timer();
+        m_resolver.async_resolve(
             a_hostname,
             std::to_string(a_port),
-            boost::asio::ip::tcp::resolver::query::numeric_service
-        );
-        resolver.async_resolve(
-            query,
-            [this](
+            boost::asio::ip::tcp::resolver::numeric_service,
+            [self = shared_from_this(), a_hostname, a_port, a_ttl, a_attempt_delay, a_timeout,
+             a_handler](
                 boost::system::error_code const& a_ec,
                 boost::asio::ip::tcp::resolver::results_type a_results
             ) -> void
             {
-                if (a_ec && a_ec != boost::asio::error::operation_aborted)
+                if (a_ec)
                 {
-                    boost::system::error_code ignored_ec;
-                    m_timer.cancel(ignored_ec);
-                    m_ec = a_ec;
+                    [[ maybe_unused ]] auto const operation = self->stop_timer();
+                    self->m_timeout = a_timeout;
+                    a_handler(self->make_error(a_ec));
                     return;
                 }
 
-                boost::asio::async_connect(
-                    m_socket,
+                if (a_ttl.count() > 0)
+                {
+                    resolve_cache::instance().insert(a_hostname, a_port, a_results, a_ttl);
+                }
+
+                self->connect_resolved(
                     a_results,
-                    [this](
-                        boost::system::error_code const& a_ec,
-                        [[ maybe_unused ]] auto& a_endpoint
-                    )
+                    a_attempt_delay,
+                    [self, a_timeout, a_handler](std::exception_ptr a_error) -> void
                     {
-                        boost::system::error_code ignored_ec;
-                        m_timer.cancel(ignored_ec);
-                        // NOTE - We have an error and it was not a timeout.
-                        if (a_ec && a_ec != boost::asio::error::operation_aborted)
-                        {
-                            m_ec = a_ec;
-                        }
+                        self->m_timeout = a_timeout;
+                        a_handler(a_error);
                     }
                 );
             }
         );
-
-        start_timer();
-        run_event_loop();
-        handle_error();
     }
 
-    auto close() -> void
+    // NOTE - No resolution - the address a_connection is connected to, with another port.
+    auto async_connect(
+        impl const& a_connection,
+        unsigned short a_port,
+        connection_options const& a_options,
+        completion_handler a_handler
+    )
+    -> void
     {
-        if (!m_socket.is_open())
+        if (m_socket.is_open())
         {
-            logger::error("Closing a non-opened socket!");
+            assert(false && "already connected");
+            post_error(a_handler, std::invalid_argument("Already connected"));
             return;
         }
 
-        m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_type::shutdown_both);
-        m_socket.close();
-    }
+        boost::system::error_code ec;
+        auto const peer = a_connection.m_socket.remote_endpoint(ec);
 
-    auto read(int a_max)
-    -> std::vector<char>
-    {
-        if (!m_socket.is_open())
+        if (ec)
         {
-            throw std::logic_error("Reading from socket that is not connected");
+            post_error(a_handler, std::runtime_error(ec.message()));
+            return;
         }
 
-        std::vector<char> buf(a_max);
+        boost::asio::ip::tcp::endpoint const endpoint(peer.address(), a_port);
 
-        m_socket.async_read_some(
-            boost::asio::buffer(buf, a_max),
-            [this, &buf](
-                boost::system::error_code const& a_ec,
-                size_t a_bytes_transferred
-            ) -> void
-            {
-                boost::system::error_code ignored_ec;
-                m_timer.cancel(ignored_ec);
+        if (m_socket.open(endpoint.protocol(), ec); ec)
+        {
+            post_error(a_handler, std::runtime_error(ec.message()));
+            return;
+        }
 
-                if (a_ec && a_ec != boost::asio::error::operation_aborted)
-                {
-                    m_ec = a_ec;
-                    return;
-                }
+        apply_socket_options(m_socket);
+        m_read_buffer.clear();
+        m_timeout = a_options.connect_timeout;
 
-                buf.resize(a_bytes_transferred);
+        start_timer();
+        m_socket.async_connect(
+            endpoint,
+            [self = shared_from_this(), timeout = a_options.timeout, a_handler](
+                boost::system::error_code const& a_ec
+            ) -> void
+            {
+                [[ maybe_unused ]] auto const operation = self->stop_timer();
+                self->m_timeout = timeout;
+                a_handler(a_ec ? self->make_error(a_ec) : nullptr);
             }
         );
-
-        start_timer();
-        run_event_loop();
-        handle_error();
-
-        return buf;
     }
 
-    auto read_until(std::string const& a_delimiter)
-    -> std::string
+    /**
+     * Connection attempts of a Happy Eyeballs (RFC8305) connect. The attempts race on sockets of
+     * their own, the first one to connect is moved into m_socket.
+     */
+    struct connect_race
     {
-        if (!m_socket.is_open())
-        {
-            throw std::logic_error("Reading from socket that is not connected");
-        }
+        // NOTE - Address families interleaved, starting with the one the resolver put first.
+        std::vector<boost::asio::ip::tcp::endpoint> m_endpoints;
+        std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> m_sockets;
+        boost::asio::steady_timer m_attempt_timer;
+        std::chrono::milliseconds m_attempt_delay;
+        std::size_t m_next{0};
+        std::size_t m_pending{0};
+        bool m_done{false};
+        boost::system::error_code m_last_error{boost::asio::error::host_not_found};
 
-        std::vector<char> buf;
+        connect_race(
+            boost::asio::io_context& a_io_context,
+            std::chrono::milliseconds a_attempt_delay
+        ) :
+            m_attempt_timer(a_io_context),
+            m_attempt_delay(a_attempt_delay)
+        { }
 
-        boost::asio::async_read_until(
-            m_socket,
-            boost::asio::dynamic_buffer(buf),
-            a_delimiter,
-            [this](
-                boost::system::error_code const& a_ec,
-                [[ maybe_unused ]] size_t a_bytes_transferred
-            ) -> void
-            {
-                boost::system::error_code ignored_ec;
-                m_timer.cancel(ignored_ec);
+        auto cancel() noexcept -> void
+        {
+            boost::system::error_code ignored_ec;
+            m_attempt_timer.cancel(ignored_ec);
 
-                if (a_ec && a_ec != boost::asio::error::operation_aborted)
+            for (auto& socket : m_sockets)
+            {
+                if (socket)
                 {
-                    m_ec = a_ec;
+                    socket->close(ignored_ec);
                 }
             }
-        );
-
-        start_timer();
-        run_event_loop();
-        handle_error();
-
-        return std::string(buf.begin(), buf.end());
-    }
+        }
+    };
 
-    auto read_until(char a_delimiter)
-    -> std::string
+    // NOTE - Expects the timer to be started.
+    auto connect_resolved(
+        boost::asio::ip::tcp::resolver::results_type const& a_results,
+        std::chrono::milliseconds a_attempt_delay,
+        completion_handler a_handler
+    )
+    -> void
     {
-        if (!m_socket.is_open())
+        auto race = std::make_shared<connect_race>(m_io_context, a_attempt_delay);
+        std::vector<boost::asio::ip::tcp::endpoint> first_family;
+        std::vector<boost::asio::ip::tcp::endpoint> second_family;
+
+        for (auto const& result : a_results)
         {
-            throw std::logic_error("Reading from socket that is not connected");
-        }
+            auto const& endpoint = result.endpoint();
+            auto const first{
+                endpoint.address().is_v6() == a_results.begin()->endpoint().address().is_v6()
+            };
 
-        std::vector<char> buf;
+            (first ? first_family : second_family).push_back(endpoint);
+        }
 
-        boost::asio::async_read_until(
-            m_socket,
-            boost::asio::dynamic_buffer(buf),
-            a_delimiter,
-            [this](
-                boost::system::error_code const& a_ec,
-                [[ maybe_unused ]] size_t a_bytes_transferred
-            ) -> void
+        for (std::size_t i = 0; i < std::max(first_family.size(), second_family.size()); ++i)
+        {
+            if (i < first_family.size())
             {
-                boost::system::error_code ignored_ec;
-                m_timer.cancel(ignored_ec);
+                race->m_endpoints.push_back(first_family[i]);
+            }
 
-                if (a_ec && a_ec != boost::asio::error::operation_aborted)
-                {
-                    m_ec = a_ec;
-                }
+            if (i < second_family.size())
+            {
+                race->m_endpoints.push_back(second_family[i]);
             }
-        );
+        }
 
-        start_timer();
-        run_event_loop();
-        handle_error();
+        race->m_sockets.resize(race->m_endpoints.size());
+        m_race = race;
+        start_connect_attempt(race, a_handler);
 
-        return std::string(buf.begin(), buf.end());
+        if (race->m_pending == 0)
+        {
+            m_race.reset();
+            [[ maybe_unused ]] auto const operation = stop_timer();
+            post_error(a_handler, std::runtime_error(race->m_last_error.message()));
+        }
     }
 
-    auto write(std::string const& a_buf)
+    auto start_connect_attempt(
+        std::shared_ptr<connect_race> a_race,
+        completion_handler a_handler
+    )
     -> void
     {
-        if (!m_socket.is_open())
+        if (a_race->m_done || m_timed_out || a_race->m_next >= a_race->m_endpoints.size())
         {
-            throw std::logic_error("Writing to socket that is not connected");
+            return;
         }
 
-        boost::asio::async_write(
+        auto const index{a_race->m_next++};
+        auto& socket = a_race->m_sockets[index];
+
+        socket = std::make_unique<boost::asio::ip::tcp::socket>(m_io_context);
+
+        // NOTE - If it cannot be opened here, async_connect reports the same error.
+        if (boost::system::error_code ec; !socket->open(a_race->m_endpoints[index].protocol(), ec))
+        {
+            apply_socket_options(*socket);
+        }
+
+        ++a_race->m_pending;
+        socket->async_connect(
+            a_race->m_endpoints[index],
+            [self = shared_from_this(), a_race, index, a_handler](
+                boost::system::error_code const& a_ec
+            ) -> void
+            {
+                --a_race->m_pending;
+
+                if (a_race->m_done)
+                {
+                    return;
+                }
+
+                if (!a_ec)
+                {
+                    a_race->m_done = true;
+                    self->m_socket = std::move(*a_race->m_sockets[index]);
+                    a_race->cancel();
+                    self->m_race.reset();
+
+                    [[ maybe_unused ]] auto const operation = self->stop_timer();
+                    a_handler(nullptr);
+                    return;
+                }
+
+                a_race->m_last_error = a_ec;
+
+                // NOTE - A failed attempt does not wait out the delay before the next one.
+                boost::system::error_code ignored_ec;
+                a_race->m_attempt_timer.cancel(ignored_ec);
+                self->start_connect_attempt(a_race, a_handler);
+
+                if (a_race->m_pending == 0)
+                {
+                    a_race->m_done = true;
+                    self->m_race.reset();
+
+                    [[ maybe_unused ]] auto const operation = self->stop_timer();
+                    a_handler(self->make_error(a_race->m_last_error));
+                }
+            }
+        );
+
+        if (a_race->m_next < a_race->m_endpoints.size())
+        {
+            a_race->m_attempt_timer.expires_after(a_race->m_attempt_delay);
+            a_race->m_attempt_timer.async_wait([self = shared_from_this(), a_race, a_handler](
+                boost::system::error_code const& a_ec
+            ) -> void
+            {
+                if (!a_ec)
+                {
+                    self->start_connect_attempt(a_race, a_handler);
+                }
+            });
+        }
+    }
+
+    auto close() -> void
+    {
+        if (!m_socket.is_open())
+        {
+            logger::error("Closing a non-opened socket!");
+            return;
+        }
+
+        m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_type::shutdown_both);
+        m_socket.close();
+    }
+
+    auto abort() noexcept -> void
+    {
+        boost::system::error_code ignored_ec;
+        m_socket.set_option(boost::asio::socket_base::linger(true, 0), ignored_ec);
+        m_socket.close(ignored_ec);
+
+        if (m_race)
+        {
+            m_race->cancel();
+        }
+    }
+
+    auto async_read_some(
+        char* a_buf,
+        std::size_t a_size,
+        size_completion_handler a_handler
+    )
+    -> void
+    {
+        if (!m_socket.is_open())
+        {
+            post_error(a_handler, std::logic_error("Reading from socket that is not connected"));
+            return;
+        }
+
+        if (!m_read_buffer.empty())
+        {
+            auto const size = std::min(a_size, m_read_buffer.size());
+
+            std::copy_n(m_read_buffer.begin(), size, a_buf);
+            m_read_buffer.erase(0, size);
+            boost::asio::post(m_io_context, [a_handler, size]() -> void
+            {
+                a_handler(nullptr, size);
+            });
+            return;
+        }
+
+        start_timer();
+        m_socket.async_read_some(
+            boost::asio::buffer(a_buf, a_size),
+            [self = shared_from_this(), a_handler](
+                boost::system::error_code const& a_ec,
+                size_t a_bytes_transferred
+            ) -> void
+            {
+                [[ maybe_unused ]] auto const operation = self->stop_timer();
+                a_handler(a_ec ? self->make_error(a_ec) : nullptr, a_bytes_transferred);
+            }
+        );
+    }
+
+    auto async_read_reply(string_completion_handler a_handler) -> void
+    {
+        if (!m_socket.is_open())
+        {
+            post_error(a_handler, std::logic_error("Reading from socket that is not connected"));
+            return;
+        }
+
+        // NOTE - Pipelined replies may already be buffered, no need to touch the socket then.
+        if (auto const size = reply_size(m_read_buffer); size > 0)
+        {
+            std::string reply(m_read_buffer, 0, size);
+            m_read_buffer.erase(0, size);
+
+            boost::asio::post(m_io_context, [a_handler, reply = std::move(reply)]() mutable -> void
+            {
+                a_handler(nullptr, std::move(reply));
+            });
+            return;
+        }
+
+        auto const buffered = m_read_buffer.size();
+        m_read_buffer.resize(buffered + 4096);
+
+        start_timer();
+        m_socket.async_read_some(
+            boost::asio::buffer(&m_read_buffer[buffered], 4096),
+            [self = shared_from_this(), buffered, a_handler](
+                boost::system::error_code const& a_ec,
+                size_t a_bytes_transferred
+            ) -> void
+            {
+                [[ maybe_unused ]] auto const operation = self->stop_timer();
+                self->m_read_buffer.resize(buffered + a_bytes_transferred);
+
+                if (a_ec)
+                {
+                    a_handler(self->make_error(a_ec), {});
+                    return;
+                }
+
+                self->async_read_reply(a_handler);
+            }
+        );
+    }
+
+    auto async_write(
+        command_line const& a_command,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        // NOTE - Keeps the capacity, the buffer stops allocating once it fits the longest command.
+        m_write_buffer.clear();
+        a_command.write_to(m_write_buffer);
+        logger::debug(m_write_buffer);
+        async_write(m_write_buffer.data(), m_write_buffer.size(), std::move(a_handler));
+    }
+
+    auto async_write(
+        char const* a_buf,
+        int a_buf_size,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        if (!m_socket.is_open())
+        {
+            post_error(a_handler, std::logic_error("Writing to socket that is not connected"));
+            return;
+        }
+
+        start_timer();
+        boost::asio::async_write(
             m_socket,
-            boost::asio::buffer(a_buf),
-            [this](
+            boost::asio::buffer(a_buf, a_buf_size),
+            [self = shared_from_this(), a_handler](
                 boost::system::error_code const& a_ec,
                 [[ maybe_unused ]] size_t a_bytes_transferred
             ) -> void
             {
-                boost::system::error_code ignored_ec;
-                m_timer.cancel(ignored_ec);
-
-                if (a_ec && a_ec != boost::asio::error::operation_aborted)
-                {
-                    m_ec = a_ec;
-                }
+                [[ maybe_unused ]] auto const operation = self->stop_timer();
+                a_handler(a_ec ? self->make_error(a_ec) : nullptr);
+            }
+        );
+    }
+
+    auto async_send_file(
+        int a_fd,
+        std::uint64_t a_offset,
+        std::uint64_t a_count,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        if (!m_socket.is_open())
+        {
+            post_error(a_handler, std::logic_error("Writing to socket that is not connected"));
+            return;
+        }
+
+        file_range range{a_fd, a_offset, a_count, a_count == UNTIL_END, true};
+
+        // NOTE - Pipes and sockets have no offsets to send from, they are read where they are.
+        if (::lseek(a_fd, 0, SEEK_CUR) < 0)
+        {
+            range.seekable = false;
+            send_file_buffered(range, std::move(a_handler));
+            return;
+        }
+
+#if defined(__linux__)
+        boost::system::error_code ec;
+        m_socket.non_blocking(true, ec);
+
+        if (!ec)
+        {
+            send_file_some(range, std::move(a_handler));
+            return;
+        }
+#endif
+
+        send_file_buffered(range, std::move(a_handler));
+    }
+
+#if defined(__linux__)
+    auto send_file_some(
+        file_range a_range,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        auto budget{ZERO_COPY_BUDGET};
+
+        while (!a_range.done())
+        {
+            if (budget == 0)
+            {
+                boost::asio::post(
+                    m_io_context,
+                    [self = shared_from_this(), a_range, a_handler]() -> void
+                    {
+                        self->send_file_some(a_range, a_handler);
+                    }
+                );
+                return;
+            }
+
+            auto offset = static_cast<off_t>(a_range.offset);
+            auto const sent = ::sendfile(
+                m_socket.native_handle(),
+                a_range.fd,
+                &offset,
+                static_cast<std::size_t>(std::min(a_range.remaining, budget))
+            );
+
+            if (sent > 0)
+            {
+                a_range.advance(static_cast<std::uint64_t>(sent));
+                budget -= static_cast<std::uint64_t>(sent);
+                continue;
+            }
+
+            if (sent == 0)
+            {
+                if (!a_range.until_end)
+                {
+                    post_error(a_handler, file_ended_error(a_range.remaining));
+                    return;
+                }
+
+                break;
+            }
+
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                start_timer();
+                m_socket.async_wait(
+                    boost::asio::ip::tcp::socket::wait_write,
+                    [self = shared_from_this(), a_range, a_handler](
+                        boost::system::error_code const& a_ec
+                    ) -> void
+                    {
+                        [[ maybe_unused ]] auto const operation = self->stop_timer();
+
+                        if (a_ec)
+                        {
+                            a_handler(self->make_error(a_ec));
+                            return;
+                        }
+
+                        self->send_file_some(a_range, a_handler);
+                    }
+                );
+                return;
+            }
+
+            if (errno == EINVAL || errno == ENOSYS)
+            {
+                // NOTE - A file sendfile cannot map (some FUSE mounts) - copy it instead.
+                send_file_buffered(a_range, std::move(a_handler));
+                return;
+            }
+
+            a_handler(make_error(
+                boost::system::error_code(errno, boost::system::system_category())
+            ));
+            return;
+        }
+
+        boost::asio::post(m_io_context, [a_handler]() -> void
+        {
+            a_handler(nullptr);
+        });
+    }
+#endif
+
+    // NOTE - The file shrank since the count was taken, the upload would pass for a complete one.
+    static auto file_ended_error(std::uint64_t a_remaining) -> std::runtime_error
+    {
+        return std::runtime_error(
+            "File ended with " + std::to_string(a_remaining) + " bytes left to send"
+        );
+    }
+
+    auto send_file_buffered(
+        file_range a_range,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        m_file_buffer.resize(65536);
+
+        auto const size{static_cast<std::size_t>(
+            std::min<std::uint64_t>(a_range.remaining, m_file_buffer.size())
+        )};
+        ssize_t read{0};
+
+        do
+        {
+            read = a_range.seekable
+                ? ::pread(a_range.fd, m_file_buffer.data(), size,
+                          static_cast<off_t>(a_range.offset))
+                : ::read(a_range.fd, m_file_buffer.data(), size);
+        } while (read < 0 && errno == EINTR);
+
+        if (read < 0)
+        {
+            post_error(
+                a_handler,
+                boost::system::system_error(errno, boost::system::system_category())
+            );
+            return;
+        }
+
+        if (read == 0)
+        {
+            if (!a_range.until_end)
+            {
+                post_error(a_handler, file_ended_error(a_range.remaining));
+                return;
+            }
+
+            boost::asio::post(m_io_context, [a_handler]() -> void
+            {
+                a_handler(nullptr);
+            });
+            return;
+        }
+
+        async_write(
+            m_file_buffer.data(),
+            static_cast<int>(read),
+            [self = shared_from_this(), a_range, read, a_handler](
+                std::exception_ptr a_error
+            ) mutable -> void
+            {
+                a_range.advance(static_cast<std::uint64_t>(read));
+
+                if (a_error || a_range.done())
+                {
+                    a_handler(a_error);
+                    return;
+                }
+
+                self->send_file_buffered(a_range, a_handler);
+            }
+        );
+    }
+
+    auto async_receive_file(
+        int a_fd,
+        std::uint64_t a_offset,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        if (!m_socket.is_open())
+        {
+            post_error(a_handler, std::logic_error("Reading from socket that is not connected"));
+            return;
+        }
+
+        // NOTE - Pipes and sockets have no offsets to write at, they are written where they are.
+        auto const seekable{::lseek(a_fd, 0, SEEK_CUR) >= 0};
+
+        if (!m_read_buffer.empty())
+        {
+            if (!write_file(a_fd, seekable, a_offset, m_read_buffer.data(), m_read_buffer.size()))
+            {
+                post_error(
+                    a_handler,
+                    boost::system::system_error(errno, boost::system::system_category())
+                );
+                return;
+            }
+
+            a_offset += m_read_buffer.size();
+            m_read_buffer.clear();
+        }
+
+#if defined(__linux__)
+        boost::system::error_code ec;
+        m_socket.non_blocking(true, ec);
+
+        int pipe_fds[2];
+
+        if (!ec && ::pipe2(pipe_fds, O_CLOEXEC | O_NONBLOCK) == 0)
+        {
+            auto pipe = std::make_shared<std::pair<file_descriptor, file_descriptor>>(
+                std::piecewise_construct,
+                std::forward_as_tuple(pipe_fds[0]),
+                std::forward_as_tuple(pipe_fds[1])
+            );
+
+            splice_some(pipe, a_fd, seekable, a_offset, std::move(a_handler));
+            return;
+        }
+#endif
+
+        receive_file_buffered(a_fd, seekable, a_offset, std::move(a_handler));
+    }
+
+    static auto write_file(
+        int a_fd,
+        bool a_seekable,
+        std::uint64_t a_offset,
+        char const* a_data,
+        std::size_t a_size
+    )
+    noexcept -> bool
+    {
+        while (a_size > 0)
+        {
+            auto const written = a_seekable
+                ? ::pwrite(a_fd, a_data, a_size, static_cast<off_t>(a_offset))
+                : ::write(a_fd, a_data, a_size);
+
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                return false;
+            }
+
+            a_data += written;
+            a_size -= static_cast<std::size_t>(written);
+            a_offset += static_cast<std::uint64_t>(written);
+        }
+
+        return true;
+    }
+
+#if defined(__linux__)
+    auto splice_some(
+        std::shared_ptr<std::pair<file_descriptor, file_descriptor>> a_pipe,
+        int a_fd,
+        bool a_seekable,
+        std::uint64_t a_offset,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        auto const system_error = [this]() -> std::exception_ptr
+        {
+            return make_error(boost::system::error_code(errno, boost::system::system_category()));
+        };
+
+        auto budget{ZERO_COPY_BUDGET};
+
+        while (true)
+        {
+            if (budget == 0)
+            {
+                boost::asio::post(
+                    m_io_context,
+                    [self = shared_from_this(), a_pipe, a_fd, a_seekable, a_offset, a_handler]()
+                    -> void
+                    {
+                        self->splice_some(a_pipe, a_fd, a_seekable, a_offset, a_handler);
+                    }
+                );
+                return;
+            }
+
+            auto const moved = ::splice(
+                m_socket.native_handle(),
+                nullptr,
+                a_pipe->second.get(),
+                nullptr,
+                static_cast<std::size_t>(std::min<std::uint64_t>(budget, 1 << 20)),
+                SPLICE_F_MOVE | SPLICE_F_NONBLOCK
+            );
+
+            if (moved == 0)
+            {
+                break;
+            }
+
+            if (moved < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    start_timer();
+                    m_socket.async_wait(
+                        boost::asio::ip::tcp::socket::wait_read,
+                        [self = shared_from_this(), a_pipe, a_fd, a_seekable, a_offset, a_handler](
+                            boost::system::error_code const& a_ec
+                        ) -> void
+                        {
+                            [[ maybe_unused ]] auto const operation = self->stop_timer();
+
+                            if (a_ec)
+                            {
+                                a_handler(self->make_error(a_ec));
+                                return;
+                            }
+
+                            self->splice_some(a_pipe, a_fd, a_seekable, a_offset, a_handler);
+                        }
+                    );
+                    return;
+                }
+
+                if (errno == EINVAL)
+                {
+                    // NOTE - Nothing went into the pipe - the socket cannot be spliced.
+                    receive_file_buffered(a_fd, a_seekable, a_offset, std::move(a_handler));
+                    return;
+                }
+
+                a_handler(system_error());
+                return;
+            }
+
+            for (auto left = static_cast<std::size_t>(moved); left > 0;)
+            {
+                auto offset = static_cast<off_t>(a_offset);
+                auto written = ::splice(
+                    a_pipe->first.get(),
+                    nullptr,
+                    a_fd,
+                    a_seekable ? &offset : nullptr,
+                    left,
+                    SPLICE_F_MOVE
+                );
+
+                if (written < 0 && errno == EINVAL)
+                {
+                    // NOTE - The file does not support splice (O_APPEND, some file systems).
+                    m_file_buffer.resize(65536);
+                    written = ::read(
+                        a_pipe->first.get(),
+                        m_file_buffer.data(),
+                        std::min(left, m_file_buffer.size())
+                    );
+
+                    if (written > 0 && !write_file(
+                        a_fd,
+                        a_seekable,
+                        a_offset,
+                        m_file_buffer.data(),
+                        static_cast<std::size_t>(written)
+                    ))
+                    {
+                        written = -1;
+                    }
+                }
+
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    a_handler(system_error());
+                    return;
+                }
+
+                a_offset += static_cast<std::uint64_t>(written);
+                left -= static_cast<std::size_t>(written);
+            }
+
+            budget -= static_cast<std::uint64_t>(moved);
+        }
+
+        boost::asio::post(m_io_context, [a_handler]() -> void
+        {
+            a_handler(nullptr);
+        });
+    }
+#endif
+
+    auto receive_file_buffered(
+        int a_fd,
+        bool a_seekable,
+        std::uint64_t a_offset,
+        completion_handler a_handler
+    )
+    -> void
+    {
+        m_file_buffer.resize(65536);
+
+        start_timer();
+        m_socket.async_read_some(
+            boost::asio::buffer(m_file_buffer),
+            [self = shared_from_this(), a_fd, a_seekable, a_offset, a_handler](
+                boost::system::error_code const& a_ec,
+                size_t a_bytes_transferred
+            ) -> void
+            {
+                [[ maybe_unused ]] auto const operation = self->stop_timer();
+
+                if (a_ec == boost::asio::error::eof)
+                {
+                    a_handler(nullptr);
+                    return;
+                }
+
+                if (a_ec)
+                {
+                    a_handler(self->make_error(a_ec));
+                    return;
+                }
+
+                if (!write_file(
+                    a_fd,
+                    a_seekable,
+                    a_offset,
+                    self->m_file_buffer.data(),
+                    a_bytes_transferred
+                ))
+                {
+                    a_handler(std::make_exception_ptr(
+                        boost::system::system_error(errno, boost::system::system_category())
+                    ));
+                    return;
+                }
+
+                self->receive_file_buffered(
+                    a_fd,
+                    a_seekable,
+                    a_offset + a_bytes_transferred,
+                    a_handler
+                );
+            }
+        );
+    }
+
+    auto is_open() noexcept -> bool
+    {
+        return m_socket.is_open();
+    }
+};
+
+client::connection::connection(boost::asio::io_context& a_io_context) :
+    m_impl(std::make_shared<client::connection::impl>(a_io_context))
+{ }
+
+client::connection::~connection() noexcept
+{
+    if (is_open())
+    {
+        try
+        {
+            close();
+        } catch (std::exception const& e)
+        {
+            logger::error(e.what());
+        }
+    }
+}
+
+auto client::connection::async_connect(
+    std::string const& a_host,
+    int a_port,
+    connection_options const& a_options,
+    completion_handler a_handler
+)
+-> void
+{
+    m_impl->async_connect(a_host, a_port, a_options, std::move(a_handler));
+}
+
+auto client::connection::async_connect(
+    connection const& a_connection,
+    unsigned short a_port,
+    connection_options const& a_options,
+    completion_handler a_handler
+)
+-> void
+{
+    m_impl->async_connect(*a_connection.m_impl, a_port, a_options, std::move(a_handler));
+}
+
+auto client::connection::close() -> void
+{
+    m_impl->close();
+}
+
+auto client::connection::abort() noexcept -> void
+{
+    m_impl->abort();
+}
+
+auto client::connection::async_read_some(
+    char* a_buf,
+    std::size_t a_size,
+    size_completion_handler a_handler
+)
+-> void
+{
+    m_impl->async_read_some(a_buf, a_size, std::move(a_handler));
+}
+
+auto client::connection::async_read_reply(string_completion_handler a_handler)
+-> void
+{
+    m_impl->async_read_reply([a_handler](std::exception_ptr a_error, std::string a_result) -> void
+    {
+        logger::debug(a_result);
+        a_handler(a_error, std::move(a_result));
+    });
+}
+
+auto client::connection::async_write(
+    command_line const& a_command,
+    completion_handler a_handler
+)
+-> void
+{
+    m_impl->async_write(a_command, std::move(a_handler));
+}
+
+auto client::connection::async_write(
+    char const* a_buf,
+    int a_buf_size,
+    completion_handler a_handler
+)
+-> void
+{
+    m_impl->async_write(a_buf, a_buf_size, std::move(a_handler));
+}
+
+auto client::connection::async_send_file(
+    int a_fd,
+    std::uint64_t a_offset,
+    std::uint64_t a_count,
+    completion_handler a_handler
+)
+-> void
+{
+    m_impl->async_send_file(a_fd, a_offset, a_count, std::move(a_handler));
+}
+
+auto client::connection::async_receive_file(
+    int a_fd,
+    std::uint64_t a_offset,
+    completion_handler a_handler
+)
+-> void
+{
+    m_impl->async_receive_file(a_fd, a_offset, std::move(a_handler));
+}
+
+auto client::connection::is_open() noexcept
+-> bool
+{
+    return m_impl->is_open();
+}
+
+auto client::connection::set_deadline(std::chrono::steady_clock::time_point a_deadline) noexcept
+-> void
+{
+    m_impl->set_deadline(a_deadline);
+}
+
+auto client::connection::set_socket_options(socket_options const& a_options) noexcept
+-> void
+{
+    m_impl->set_socket_options(a_options);
+}
+
+static auto set_log_level(bool a_debug) -> void
+{
+    if (a_debug)
+    {
+        logger::set_log_level(log_level::DEBUG);
+    } else
+    {
+        logger::set_log_level(log_level::ERROR);
+    }
+}
+
+static auto is_end_of_file(std::exception_ptr const& a_error) -> bool
+{
+    try
+    {
+        std::rethrow_exception(a_error);
+    } catch (end_of_file_error const&)
+    {
+        return true;
+    } catch (...)
+    {
+        return false;
+    }
+}
+
+static auto is_timeout(std::exception_ptr const& a_error) -> bool
+{
+    try
+    {
+        std::rethrow_exception(a_error);
+    } catch (timeout_error const&)
+    {
+        return true;
+    } catch (...)
+    {
+        return false;
+    }
+}
+
+static auto reply_text(std::string const& a_response) -> std::string
+{
+    if (a_response.size() > 4)
+    {
+        auto ret{a_response.substr(4)};
+        logger::debug(ret);
+        return ret;
+    }
+
+    throw std::length_error("Server returned malformed response");
+}
+
+// NOTE - Replies to a window must fit in the socket buffers, otherwise the server blocks writing
+//        them while the client blocks writing the rest of the window.
+static constexpr std::size_t PIPELINE_WINDOW{64};
+
+auto command_batch::cwd(std::string const& a_new_wd)
+-> command_batch&
+{
+    return add(cwd_command(a_new_wd), {reply_code::FILE_ACTION_COMPLETED_250});
+}
+
+auto command_batch::cdup()
+-> command_batch&
+{
+    return add(cdup_command(), {reply_code::OK_200, reply_code::FILE_ACTION_COMPLETED_250});
+}
+
+auto command_batch::rename(
+    std::string const& a_file_to_rename,
+    std::string const& a_rename_to
+)
+-> command_batch&
+{
+    add(rnfr_command(a_file_to_rename), {reply_code::REQUESTED_FILE_ACTION_INFO_PENDING_350});
+    return add(rnto_command(a_rename_to), {reply_code::FILE_ACTION_COMPLETED_250});
+}
+
+auto command_batch::remove_file(std::string const& a_filepath)
+-> command_batch&
+{
+    return add(dele_command(a_filepath), {reply_code::FILE_ACTION_COMPLETED_250});
+}
+
+auto command_batch::rmdir(std::string const& a_dirpath)
+-> command_batch&
+{
+    return add(rmd_command(a_dirpath), {reply_code::FILE_ACTION_COMPLETED_250});
+}
+
+auto command_batch::mkdir(std::string const& a_dirpath)
+-> command_batch&
+{
+    return add(mkd_command(a_dirpath), {reply_code::PATHNAME_CREATED_257});
+}
+
+auto command_batch::noop()
+-> command_batch&
+{
+    return add(noop_command(), {reply_code::OK_200});
+}
+
+auto command_batch::size() const noexcept
+-> std::size_t
+{
+    return m_commands.size();
+}
+
+auto command_batch::empty() const noexcept
+-> bool
+{
+    return m_commands.empty();
+}
+
+auto command_batch::add(
+    command_line const& a_command,
+    reply_code_set a_accepted_codes
+)
+-> command_batch&
+{
+    a_command.write_to(m_buffer);
+    m_commands.push_back({m_buffer.size(), a_accepted_codes});
+    return *this;
+}
+
+client::client() :
+    m_owned_io_context(std::make_unique<boost::asio::io_context>(1)),
+    m_io_context(*m_owned_io_context),
+    m_control_connection(m_io_context),
+    m_mlsd_unsupported(false)
+{ }
+
+client::client(connection_options const& a_opts) :
+    m_options(a_opts),
+    m_owned_io_context(std::make_unique<boost::asio::io_context>(1)),
+    m_io_context(*m_owned_io_context),
+    m_control_connection(m_io_context),
+    m_mlsd_unsupported(false)
+{
+    assert(!a_opts.server_hostname.empty() && "empty hostname");
+    assert(a_opts.server_port > 0 && "negative server port");
+
+    set_log_level(a_opts.debug_output);
+}
+
+client::client(boost::asio::io_context& a_io_context) :
+    m_io_context(a_io_context),
+    m_control_connection(m_io_context),
+    m_mlsd_unsupported(false)
+{ }
+
+client::client(
+    boost::asio::io_context& a_io_context,
+    connection_options const& a_opts
+) :
+    m_options(a_opts),
+    m_io_context(a_io_context),
+    m_control_connection(m_io_context),
+    m_mlsd_unsupported(false)
+{
+    assert(!a_opts.server_hostname.empty() && "empty hostname");
+    assert(a_opts.server_port > 0 && "negative server port");
+
+    set_log_level(a_opts.debug_output);
+}
+
+auto client::set_connection_options(connection_options const& a_opts) noexcept
+-> void
+{
+    m_options = a_opts;
+    set_log_level(a_opts.debug_output);
+}
+
+auto client::connect()
+-> void
+{
+    connect(m_options.server_hostname, m_options.server_port);
+}
+
+auto client::connect(
+    std::string const& a_hostname,
+    int a_port
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_connect(a_hostname, a_port, std::move(a_handler));
+    });
+}
+
+auto client::close()
+-> void
+{
+    run_blocking(m_io_context, [this](completion_handler a_handler) -> void
+    {
+        start_close(std::move(a_handler));
+    });
+}
+
+auto client::login()
+-> void
+{
+    login(m_options.username, m_options.password);
+}
+
+auto client::login(
+    std::string const& a_username,
+    std::string const& a_password
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_login(a_username, a_password, std::move(a_handler));
+    });
+}
+
+auto client::cwd(std::string const& a_new_wd)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_cwd(a_new_wd, std::move(a_handler));
+    });
+}
+
+auto client::cdup()
+-> void
+{
+    run_blocking(m_io_context, [this](completion_handler a_handler) -> void
+    {
+        start_cdup(std::move(a_handler));
+    });
+}
+
+auto client::run(std::function<void(completion_handler)> const& a_start)
+-> void
+{
+    run_blocking(m_io_context, a_start);
+}
+
+auto client::download(std::string const& a_filename)
+-> std::vector<char>
+{
+    return run_blocking<std::vector<char>>(
+        m_io_context,
+        [&, this](bytes_completion_handler a_handler) -> void
+        {
+            start_download(a_filename, std::move(a_handler));
+        }
+    );
+}
+
+auto client::download(
+    std::string const& a_filename,
+    char* a_buffer,
+    std::size_t a_size
+)
+-> std::size_t
+{
+    return run_blocking<std::size_t>(
+        m_io_context,
+        [&, this](size_completion_handler a_handler) -> void
+        {
+            start_download(a_filename, a_buffer, a_size, std::move(a_handler));
+        }
+    );
+}
+
+auto client::download(
+    std::string const& a_filename,
+    std::ofstream& a_ofstream
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_download(a_filename, a_ofstream, std::move(a_handler));
+    });
+}
+
+auto client::upload(
+    std::string const& a_filename,
+    std::istream& a_istream
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_upload(a_filename, a_istream, std::move(a_handler));
+    });
+}
+
+auto client::download(
+    std::string const& a_filename,
+    std::filesystem::path const& a_local_path
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_download(a_filename, a_local_path, std::move(a_handler));
+    });
+}
+
+auto client::download(
+    std::string const& a_filename,
+    int a_fd
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_download(a_filename, a_fd, std::move(a_handler));
+    });
+}
+
+auto client::download_files(
+    std::vector<std::string> const& a_filenames,
+    std::function<void(std::size_t, char const*, std::size_t)> a_data_callback
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_download_files(a_filenames, a_data_callback, std::move(a_handler));
+    });
+}
+
+auto client::upload(
+    std::string const& a_filename,
+    std::filesystem::path const& a_local_path
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_upload(a_filename, a_local_path, std::move(a_handler));
+    });
+}
+
+auto client::upload(
+    std::string const& a_filename,
+    int a_fd
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_upload(a_filename, a_fd, std::move(a_handler));
+    });
+}
+
+auto client::rename(
+    std::string const& a_file_to_rename,
+    std::string const& a_rename_to
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_rename(a_file_to_rename, a_rename_to, std::move(a_handler));
+    });
+}
+
+auto client::remove_file(std::string const& a_filepath)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_remove_file(a_filepath, std::move(a_handler));
+    });
+}
+
+auto client::rmdir(std::string const& a_dirpath)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_rmdir(a_dirpath, std::move(a_handler));
+    });
+}
+
+auto client::mkdir(std::string const& a_dirpath)
+-> void
+{
+    run_blocking(m_io_context, [&, this](completion_handler a_handler) -> void
+    {
+        start_mkdir(a_dirpath, std::move(a_handler));
+    });
+}
+
+auto client::pwd()
+-> std::string
+{
+    return run_blocking<std::string>(
+        m_io_context,
+        [this](string_completion_handler a_handler) -> void
+        {
+            start_pwd(std::move(a_handler));
+        }
+    );
+}
+
+auto client::ls()
+-> std::string
+{
+    return ls(std::string{});
+}
+
+auto client::ls(std::string const& a_pathname)
+-> std::string
+{
+    return run_blocking<std::string>(
+        m_io_context,
+        [&, this](string_completion_handler a_handler) -> void
+        {
+            start_ls(a_pathname, std::move(a_handler));
+        }
+    );
+}
+
+auto client::list(std::string const& a_pathname)
+-> std::string
+{
+    return run_blocking<std::string>(
+        m_io_context,
+        [&, this](string_completion_handler a_handler) -> void
+        {
+            start_list(a_pathname, std::move(a_handler));
+        }
+    );
+}
+
+auto client::list_directory(std::string const& a_pathname)
+-> directory_listing
+{
+    return run_blocking<directory_listing>(
+        m_io_context,
+        [&, this](listing_completion_handler a_handler) -> void
+        {
+            start_list_directory(a_pathname, std::move(a_handler));
+        }
+    );
+}
+
+auto client::list_directory(
+    std::string const& a_pathname,
+    std::function<void(listing_entry const&)> a_entry_callback
+)
+-> void
+{
+    run_blocking(
+        m_io_context,
+        [&, this](completion_handler a_handler) -> void
+        {
+            start_list_directory(a_pathname, a_entry_callback, std::move(a_handler));
+        }
+    );
+}
+
+auto client::size(std::string const& a_filepath)
+-> std::size_t
+{
+    return run_blocking<std::size_t>(
+        m_io_context,
+        [&, this](size_completion_handler a_handler) -> void
+        {
+            start_size(a_filepath, std::move(a_handler));
+        }
+    );
+}
+
+auto client::system_info()
+-> std::string
+{
+    return run_blocking<std::string>(
+        m_io_context,
+        [this](string_completion_handler a_handler) -> void
+        {
+            start_system_info(std::move(a_handler));
+        }
+    );
+}
+
+auto client::features()
+-> std::vector<std::string>
+{
+    return run_blocking<std::vector<std::string>>(
+        m_io_context,
+        [this](features_completion_handler a_handler) -> void
+        {
+            start_features(std::move(a_handler));
+        }
+    );
+}
+
+auto client::progress()
+-> std::string
+{
+    return run_blocking<std::string>(
+        m_io_context,
+        [this](string_completion_handler a_handler) -> void
+        {
+            start_progress(std::move(a_handler));
+        }
+    );
+}
+
+auto client::noop()
+-> void
+{
+    run_blocking(m_io_context, [this](completion_handler a_handler) -> void
+    {
+        start_noop(std::move(a_handler));
+    });
+}
+
+auto client::is_open() noexcept
+-> bool
+{
+    return m_control_connection.is_open();
+}
+
+auto client::execute(command_batch const& a_batch)
+-> std::vector<command_reply>
+{
+    return run_blocking<std::vector<command_reply>>(
+        m_io_context,
+        [&, this](batch_completion_handler a_handler) -> void
+        {
+            start_execute(a_batch, std::move(a_handler));
+        }
+    );
+}
+
+auto client::start_connect(
+    std::string const& a_hostname,
+    int a_port,
+    completion_handler a_handler
+)
+-> void
+{
+    m_control_connection.set_socket_options(m_options.control_socket);
+    m_control_connection.async_connect(
+        a_hostname,
+        a_port,
+        m_options,
+        [this, a_handler](std::exception_ptr a_error) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            read_reply(
+                {
+                    reply_code::OK_200,
+                    reply_code::READY_FOR_NEW_USER_220
+                },
+                [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply)
+                -> void
+                {
+                    a_handler(a_error);
+                }
+            );
+        }
+    );
+}
+
+auto client::start_close(completion_handler a_handler)
+-> void
+{
+    if (!m_control_connection.is_open())
+    {
+        boost::asio::post(m_io_context, [a_handler]() -> void
+        {
+            a_handler(nullptr);
+        });
+        return;
+    }
+
+    send_command(
+        quit_command(),
+        {reply_code::CLOSING_CONTROL_CONNECTION_221},
+        [this, a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply)
+        -> void
+        {
+            if (!a_error)
+            {
+                try
+                {
+                    m_control_connection.close();
+                } catch (...)
+                {
+                    a_error = std::current_exception();
+                }
+            }
+
+            a_handler(a_error);
+        }
+    );
+}
+
+auto client::start_login(
+    std::string const& a_username,
+    std::string const& a_password,
+    completion_handler a_handler
+)
+-> void
+{
+    send_command(
+        user_command(a_username),
+        {
+            reply_code::USER_LOGGED_IN_230,
+            reply_code::USERNAME_OK_NEED_PASSWORD_331,
+            reply_code::NEED_ACCOUNT_332
+        },
+        [this, a_password, a_handler](
+            std::exception_ptr a_error,
+            [[ maybe_unused ]] std::string a_reply
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            send_command(
+                password_command(a_password),
+                {reply_code::USER_LOGGED_IN_230},
+                [this, a_handler](
+                    std::exception_ptr a_error,
+                    [[ maybe_unused ]] std::string a_reply
+                ) -> void
+                {
+                    if (a_error)
+                    {
+                        a_handler(a_error);
+                        return;
+                    }
+
+                    // NOTE - Transfers are byte exact - SIZE and REST offsets count the bytes of
+                    //        the file as stored, which only holds in image mode. The default type
+                    //        of the server (RFC959 - ASCII) is not relied upon.
+                    send_command(
+                        type_command(data_type::IMAGE),
+                        {reply_code::OK_200},
+                        [a_handler](
+                            std::exception_ptr a_error,
+                            [[ maybe_unused ]] std::string a_reply
+                        ) -> void
+                        {
+                            a_handler(a_error);
+                        }
+                    );
+                }
+            );
+        }
+    );
+}
+
+auto client::start_cwd(
+    std::string const& a_new_wd,
+    completion_handler a_handler
+)
+-> void
+{
+    send_command(
+        cwd_command(a_new_wd),
+        {reply_code::FILE_ACTION_COMPLETED_250},
+        [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply) -> void
+        {
+            a_handler(a_error);
+        }
+    );
+}
+
+auto client::start_cdup(completion_handler a_handler)
+-> void
+{
+    send_command(
+        cdup_command(),
+        {
+            reply_code::OK_200,
+            reply_code::FILE_ACTION_COMPLETED_250
+        },
+        [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply) -> void
+        {
+            a_handler(a_error);
+        }
+    );
+}
+
+auto client::start_download(
+    std::string const& a_filename,
+    bytes_completion_handler a_handler
+)
+-> void
+{
+    // NOTE - With the size known up front the file is read straight into its final buffer,
+    //        without the reallocations of growing it. A refused SIZE leaves the control connection
+    //        in sync, anything else ends the download.
+    start_size(
+        a_filename,
+        [this, a_filename, a_handler](std::exception_ptr a_error, std::size_t a_size) -> void
+        {
+            if (!is_open() || (a_error && !is_reply_error(a_error)))
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            auto data = std::make_shared<std::vector<char>>();
+
+            // NOTE - The SIZE reply is the server's word - a size that cannot be allocated is
+            //        not taken for an error, the buffer grows with the data instead.
+            if (!a_error)
+            {
+                try
+                {
+                    data->resize(a_size);
+                } catch (std::length_error const&)
+                {
+                } catch (std::bad_alloc const&)
+                {
+                }
+            }
+
+            start_data_transfer(
+                retr_command(a_filename),
+                [this, data, a_handler](
+                    std::exception_ptr a_error,
+                    std::shared_ptr<connection> a_data_transfer_connection
+                ) -> void
+                {
+                    if (a_error)
+                    {
+                        a_handler(a_error, {});
+                        return;
+                    }
+
+                    receive_into(
+                        a_data_transfer_connection,
+                        data->data(),
+                        data->size(),
+                        0,
+                        [this, a_data_transfer_connection, data, a_handler](
+                            std::exception_ptr a_error,
+                            std::size_t a_received
+                        ) -> void
+                        {
+                            if (a_error || a_received < data->size())
+                            {
+                                if (a_error)
+                                {
+                                    a_handler(a_error, {});
+                                    return;
+                                }
+
+                                data->resize(a_received);
+                                a_handler(nullptr, std::move(*data));
+                                return;
+                            }
+
+                            // NOTE - No SIZE, or the file grew since.
+                            receive_data(
+                                a_data_transfer_connection,
+                                [data](char const* a_data, std::size_t a_size) -> void
+                                {
+                                    data->insert(data->end(), a_data, a_data + a_size);
+                                },
+                                std::numeric_limits<std::size_t>::max(),
+                                [data, a_handler](std::exception_ptr a_error) -> void
+                                {
+                                    a_handler(
+                                        a_error,
+                                        a_error ? std::vector<char>{} : std::move(*data)
+                                    );
+                                }
+                            );
+                        }
+                    );
+                }
+            );
+        }
+    );
+}
+
+auto client::start_download(
+    std::string const& a_filename,
+    char* a_buffer,
+    std::size_t a_size,
+    size_completion_handler a_handler
+)
+-> void
+{
+    start_data_transfer(
+        retr_command(a_filename),
+        [this, a_buffer, a_size, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, 0);
+                return;
+            }
+
+            receive_into(
+                a_data_transfer_connection,
+                a_buffer,
+                a_size,
+                0,
+                [this, a_data_transfer_connection, a_size, a_handler](
+                    std::exception_ptr a_error,
+                    std::size_t a_received
+                ) -> void
+                {
+                    if (a_error || a_received < a_size)
+                    {
+                        a_handler(a_error, a_received);
+                        return;
+                    }
+
+                    // NOTE - The buffer is full - the transfer is done only if nothing follows.
+                    receive_data(
+                        a_data_transfer_connection,
+                        [](char const*, std::size_t) -> void
+                        {
+                            throw std::length_error("File does not fit in the buffer");
+                        },
+                        std::numeric_limits<std::size_t>::max(),
+                        [a_received, a_handler](std::exception_ptr a_error) -> void
+                        {
+                            a_handler(a_error, a_error ? 0 : a_received);
+                        }
+                    );
+                }
+            );
+        }
+    );
+}
+
+auto client::start_download(
+    std::string const& a_filename,
+    std::ofstream& a_ofstream,
+    completion_handler a_handler
+)
+-> void
+{
+    auto data_callback = [&a_ofstream](char const* a_data, std::size_t a_size) -> void
+    {
+        a_ofstream.write(a_data, a_size);
+    };
+
+    download_passive(a_filename, data_callback, std::move(a_handler));
+}
+
+auto client::start_download(
+    std::string const& a_filename,
+    std::filesystem::path const& a_local_path,
+    completion_handler a_handler
+)
+-> void
+{
+    // NOTE - The existing file stays untouched until the transfer completed.
+    auto partial_path{a_local_path};
+    partial_path += ".part";
+
+    auto file = std::make_shared<file_descriptor>(
+        ::open(partial_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+    );
+
+    if (file->get() < 0)
+    {
+        auto const error = std::make_exception_ptr(std::system_error(
+            errno,
+            std::generic_category(),
+            "Opening " + partial_path.string() + " failed"
+        ));
+
+        boost::asio::post(m_io_context, [a_handler, error]() -> void
+        {
+            a_handler(error);
+        });
+        return;
+    }
+
+    start_download(
+        a_filename,
+        file->get(),
+        [file, partial_path, a_local_path, a_handler](std::exception_ptr a_error) -> void
+        {
+            std::error_code ec;
+
+            if (!a_error)
+            {
+                std::filesystem::rename(partial_path, a_local_path, ec);
+
+                if (ec)
+                {
+                    a_error = std::make_exception_ptr(std::filesystem::filesystem_error(
+                        "Failed to rename",
+                        partial_path,
+                        a_local_path,
+                        ec
+                    ));
+                }
+            }
+
+            if (a_error)
+            {
+                std::filesystem::remove(partial_path, ec);
+            }
+
+            a_handler(a_error);
+        }
+    );
+}
+
+auto client::start_download(
+    std::string const& a_filename,
+    int a_fd,
+    completion_handler a_handler
+)
+-> void
+{
+    auto const position = ::lseek(a_fd, 0, SEEK_CUR);
+    auto const offset = position < 0 ? std::uint64_t{0} : static_cast<std::uint64_t>(position);
+
+    // NOTE - The size is only used to reserve the space of the file, so the download goes on
+    //        without it when the server refuses SIZE.
+    start_size(
+        a_filename,
+        [this, a_filename, a_fd, offset, a_handler](
+            std::exception_ptr a_error,
+            std::size_t a_size
+        ) -> void
+        {
+            if (!is_open() || (a_error && !is_reply_error(a_error)))
+            {
+                a_handler(a_error);
+                return;
+            }
+
+#if defined(__linux__)
+            if (a_size > 0)
+            {
+                ::fallocate(a_fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), a_size);
+            }
+#endif
+
+            start_data_transfer(
+                retr_command(a_filename),
+                [this, a_fd, offset, a_handler](
+                    std::exception_ptr a_error,
+                    std::shared_ptr<connection> a_data_transfer_connection
+                ) -> void
+                {
+                    if (a_error)
+                    {
+                        a_handler(a_error);
+                        return;
+                    }
+
+                    a_data_transfer_connection->async_receive_file(
+                        a_fd,
+                        offset,
+                        [this, a_data_transfer_connection, a_handler](std::exception_ptr a_error)
+                        -> void
+                        {
+                            if (a_error)
+                            {
+                                abort_transfer(a_data_transfer_connection, a_error, a_handler);
+                                return;
+                            }
+
+                            read_reply(
+                                {
+                                    reply_code::CLOSING_DATA_CONNECTION_226,
+                                    reply_code::FILE_ACTION_COMPLETED_250
+                                },
+                                [a_handler](
+                                    std::exception_ptr a_error,
+                                    [[ maybe_unused ]] std::string a_reply
+                                ) -> void
+                                {
+                                    a_handler(a_error);
+                                }
+                            );
+                        }
+                    );
+                }
+            );
+        }
+    );
+}
+
+auto client::start_download_files(
+    std::vector<std::string> const& a_filenames,
+    std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+    completion_handler a_handler
+)
+-> void
+{
+    download_next_file(
+        std::make_shared<std::vector<std::string> const>(a_filenames),
+        0,
+        std::move(a_data_callback),
+        std::move(a_handler)
+    );
+}
+
+auto client::download_next_file(
+    std::shared_ptr<std::vector<std::string> const> a_filenames,
+    std::size_t a_index,
+    std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+    completion_handler a_handler
+)
+-> void
+{
+    if (a_index == a_filenames->size())
+    {
+        boost::asio::post(m_io_context, [a_handler]() -> void
+        {
+            a_handler(nullptr);
+        });
+        return;
+    }
+
+    enter_passive_mode([this, a_filenames, a_index, a_data_callback, a_handler](
+        std::exception_ptr a_error,
+        std::string a_reply
+    ) -> void
+    {
+        if (a_error)
+        {
+            a_handler(a_error);
+            return;
+        }
+
+        open_data_transfer(
+            a_reply,
+            retr_command((*a_filenames)[a_index]).str(),
+            0,
+            [this, a_filenames, a_index, a_data_callback, a_handler](
+                std::exception_ptr a_error,
+                std::shared_ptr<connection> a_data_transfer_connection
+            ) -> void
+            {
+                if (a_error)
+                {
+                    a_handler(a_error);
+                    return;
+                }
+
+                receive_files(
+                    a_filenames,
+                    a_index,
+                    a_data_transfer_connection,
+                    a_data_callback,
+                    a_handler
+                );
+            }
+        );
+    });
+}
+
+auto client::receive_files(
+    std::shared_ptr<std::vector<std::string> const> a_filenames,
+    std::size_t a_index,
+    std::shared_ptr<connection> a_data_transfer_connection,
+    std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+    completion_handler a_handler
+)
+-> void
+{
+    auto const data_callback = [a_index, a_data_callback](char const* a_data, std::size_t a_size)
+    -> void
+    {
+        a_data_callback(a_index, a_data, a_size);
+    };
+
+    if (a_index + 1 == a_filenames->size())
+    {
+        receive_to_end(
+            a_data_transfer_connection,
+            std::make_shared<std::vector<char>>(65536),
+            data_callback,
+            [=](std::exception_ptr a_error) -> void
+            {
+                if (a_error)
+                {
+                    a_data_transfer_connection->abort();
+                    skip_replies(a_error, 1, a_handler);
+                    return;
+                }
+
+                read_reply(
+                    {
+                        reply_code::CLOSING_DATA_CONNECTION_226,
+                        reply_code::FILE_ACTION_COMPLETED_250
+                    },
+                    [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply)
+                    -> void
+                    {
+                        a_handler(a_error);
+                    }
+                );
+            }
+        );
+        return;
+    }
+
+    // NOTE - The data of the current file and the replies of the control connection are read at
+    //        the same time. The transfer reply often arrives before the data is drained - the
+    //        next data connection is then set up, and its RETR sent, while the current file is
+    //        still being read.
+    struct join
+    {
+        std::exception_ptr data_error{};
+        std::exception_ptr control_error{};
+        // NOTE - Replies the control branch stopped short of.
+        std::size_t replies_owed{0};
+        std::shared_ptr<connection> next{};
+        bool data_done{false};
+        // NOTE - The transfer reply timed out while the data was still arriving - a large file,
+        //        it is read again once the data is drained.
+        bool control_waiting{false};
+        int pending{2};
+    };
+
+    auto state = std::make_shared<join>();
+    // NOTE - Only for servers that queue commands received during a transfer - RFC 959 only
+    //        defines ABOR, STAT and QUIT there. Otherwise the EPSV waits for the transfer reply.
+    auto const epsv_ahead{m_options.pipeline_passive_mode};
+
+    auto done = [this, a_filenames, a_index, a_data_callback, a_handler, state]() -> void
+    {
+        if (--state->pending > 0)
+        {
+            return;
+        }
+
+        auto const error{state->data_error ? state->data_error : state->control_error};
+
+        if (!error)
+        {
+            receive_files(a_filenames, a_index + 1, state->next, a_data_callback, a_handler);
+            return;
+        }
+
+        if (state->next)
+        {
+            abort_transfer(state->next, error, a_handler);
+            return;
+        }
+
+        skip_replies(error, state->replies_owed, a_handler);
+    };
+
+    auto open_next = [this, a_filenames, a_index, state, done](
+        std::exception_ptr a_error,
+        std::string a_reply
+    ) -> void
+    {
+        if (a_error)
+        {
+            state->control_error = a_error;
+            done();
+            return;
+        }
+
+        open_data_transfer(
+            a_reply,
+            retr_command((*a_filenames)[a_index + 1]).str(),
+            0,
+            [state, done](std::exception_ptr a_error, std::shared_ptr<connection> a_next) -> void
+            {
+                state->control_error = a_error;
+                state->next = a_next;
+                done();
+            }
+        );
+    };
+
+    auto read_control = [this, state, done, open_next, epsv_ahead]() -> void
+    {
+        read_reply(
+            {
+                reply_code::CLOSING_DATA_CONNECTION_226,
+                reply_code::FILE_ACTION_COMPLETED_250
+            },
+            [this, state, done, open_next, epsv_ahead](
+                std::exception_ptr a_error,
+                [[ maybe_unused ]] std::string a_reply
+            ) -> void
+            {
+                if (a_error && is_timeout(a_error) && !state->data_done)
+                {
+                    state->control_waiting = true;
+                    return;
+                }
+
+                if (a_error)
+                {
+                    state->control_error = a_error;
+                    state->replies_owed = epsv_ahead ? 1 : 0;
+                    done();
+                    return;
+                }
+
+                if (epsv_ahead)
+                {
+                    read_passive_mode_reply(open_next);
+                } else
+                {
+                    enter_passive_mode(open_next);
+                }
+            }
+        );
+    };
+
+    auto receive = [this, a_data_transfer_connection, data_callback, state, done, read_control,
+                    epsv_ahead]() -> void
+    {
+        read_control();
+        receive_to_end(
+            a_data_transfer_connection,
+            std::make_shared<std::vector<char>>(65536),
+            data_callback,
+            [a_data_transfer_connection, state, done, read_control, epsv_ahead](
+                std::exception_ptr a_error
+            ) -> void
+            {
+                state->data_done = true;
+
+                if (a_error)
+                {
+                    // NOTE - The server sees the reset and fails the transfer.
+                    a_data_transfer_connection->abort();
+                    state->data_error = a_error;
+                }
+
+                if (state->control_waiting)
+                {
+                    state->control_waiting = false;
+
+                    if (a_error)
+                    {
+                        state->replies_owed = epsv_ahead ? 2 : 1;
+                        done();
+                    } else
+                    {
+                        read_control();
+                    }
+                }
+
+                done();
+            }
+        );
+    };
+
+    if (!epsv_ahead)
+    {
+        receive();
+        return;
+    }
+
+    m_control_connection.async_write(
+        epsv_command(),
+        [a_data_transfer_connection, receive, a_handler](std::exception_ptr a_error) -> void
+        {
+            if (a_error)
+            {
+                a_data_transfer_connection->abort();
+                a_handler(a_error);
+                return;
+            }
+
+            receive();
+        }
+    );
+}
+
+auto client::start_upload(
+    std::string const& a_filename,
+    std::istream& a_istream,
+    completion_handler a_handler
+)
+-> void
+{
+    start_data_transfer(
+        stor_command(a_filename),
+        [this, &a_istream, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            send_data(
+                a_data_transfer_connection,
+                a_istream,
+                std::make_shared<std::vector<char>>(8192),
+                std::numeric_limits<std::size_t>::max(),
+                a_handler
+            );
+        }
+    );
+}
+
+auto client::start_upload(
+    std::string const& a_filename,
+    std::filesystem::path const& a_local_path,
+    completion_handler a_handler
+)
+-> void
+{
+    auto file = std::make_shared<file_descriptor>(
+        ::open(a_local_path.c_str(), O_RDONLY | O_CLOEXEC)
+    );
+
+    if (file->get() < 0)
+    {
+        auto const error = std::make_exception_ptr(std::system_error(
+            errno,
+            std::generic_category(),
+            "Opening " + a_local_path.string() + " failed"
+        ));
+
+        boost::asio::post(m_io_context, [a_handler, error]() -> void
+        {
+            a_handler(error);
+        });
+        return;
+    }
+
+    start_upload(
+        a_filename,
+        file->get(),
+        [file, a_handler](std::exception_ptr a_error) -> void
+        {
+            a_handler(a_error);
+        }
+    );
+}
+
+auto client::start_upload(
+    std::string const& a_filename,
+    int a_fd,
+    completion_handler a_handler
+)
+-> void
+{
+    start_data_transfer(
+        stor_command(a_filename),
+        [this, a_fd, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            auto const position = ::lseek(a_fd, 0, SEEK_CUR);
+            auto const offset{
+                position < 0 ? std::uint64_t{0} : static_cast<std::uint64_t>(position)
+            };
+            auto count{std::numeric_limits<std::uint64_t>::max()};
+
+            // NOTE - With the size of a regular file known, a file that shrinks fails the upload.
+            if (struct stat status{}; ::fstat(a_fd, &status) == 0 && S_ISREG(status.st_mode))
+            {
+                auto const size{static_cast<std::uint64_t>(status.st_size)};
+                count = size > offset ? size - offset : 0;
+            }
+
+            a_data_transfer_connection->async_send_file(
+                a_fd,
+                offset,
+                count,
+                [this, a_data_transfer_connection, a_handler](std::exception_ptr a_error) -> void
+                {
+                    if (a_error)
+                    {
+                        abort_transfer(a_data_transfer_connection, a_error, a_handler);
+                        return;
+                    }
+
+                    finish_upload(a_data_transfer_connection, a_handler);
+                }
+            );
+        }
+    );
+}
+
+auto client::start_rename(
+    std::string const& a_file_to_rename,
+    std::string const& a_rename_to,
+    completion_handler a_handler
+)
+-> void
+{
+    send_command(
+        rnfr_command(a_file_to_rename),
+        {reply_code::REQUESTED_FILE_ACTION_INFO_PENDING_350},
+        [this, a_rename_to, a_handler](
+            std::exception_ptr a_error,
+            [[ maybe_unused ]] std::string a_reply
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            send_command(
+                rnto_command(a_rename_to),
+                {reply_code::FILE_ACTION_COMPLETED_250},
+                [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply)
+                -> void
+                {
+                    a_handler(a_error);
+                }
+            );
+        }
+    );
+}
+
+auto client::start_remove_file(
+    std::string const& a_filepath,
+    completion_handler a_handler
+)
+-> void
+{
+    send_command(
+        dele_command(a_filepath),
+        {reply_code::FILE_ACTION_COMPLETED_250},
+        [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply) -> void
+        {
+            a_handler(a_error);
+        }
+    );
+}
+
+auto client::start_rmdir(
+    std::string const& a_dirpath,
+    completion_handler a_handler
+)
+-> void
+{
+    send_command(
+        rmd_command(a_dirpath),
+        {reply_code::FILE_ACTION_COMPLETED_250},
+        [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply) -> void
+        {
+            a_handler(a_error);
+        }
+    );
+}
+
+auto client::start_mkdir(
+    std::string const& a_dirpath,
+    completion_handler a_handler
+)
+-> void
+{
+    send_command(
+        mkd_command(a_dirpath),
+        {reply_code::PATHNAME_CREATED_257},
+        [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply) -> void
+        {
+            a_handler(a_error);
+        }
+    );
+}
+
+auto client::start_pwd(string_completion_handler a_handler)
+-> void
+{
+    send_command(
+        pwd_command(),
+        {reply_code::PATHNAME_CREATED_257},
+        [a_handler](std::exception_ptr a_error, std::string a_reply) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            try
+            {
+                a_reply = reply_text(a_reply);
+            } catch (...)
+            {
+                a_handler(std::current_exception(), {});
+                return;
+            }
+
+            a_handler(nullptr, std::move(a_reply));
+        }
+    );
+}
+
+auto client::start_ls(
+    std::string const& a_pathname,
+    string_completion_handler a_handler
+)
+-> void
+{
+    start_data_transfer(
+        nlst_command(a_pathname),
+        [this, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            auto names = std::make_shared<std::string>();
+
+            receive_data(
+                a_data_transfer_connection,
+                [names](char const* a_data, std::size_t a_size) -> void
+                {
+                    names->append(a_data, a_size);
+                },
+                std::numeric_limits<std::size_t>::max(),
+                [names, a_handler](std::exception_ptr a_error) -> void
+                {
+                    a_handler(a_error, a_error ? std::string{} : std::move(*names));
+                }
+            );
+        }
+    );
+}
+
+auto client::start_list(
+    std::string const& a_pathname,
+    string_completion_handler a_handler
+)
+-> void
+{
+    start_data_transfer(
+        list_command(a_pathname),
+        [this, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            auto listing = std::make_shared<std::string>();
+
+            receive_data(
+                a_data_transfer_connection,
+                [listing](char const* a_data, std::size_t a_size) -> void
+                {
+                    listing->append(a_data, a_size);
+                },
+                std::numeric_limits<std::size_t>::max(),
+                [listing, a_handler](std::exception_ptr a_error) -> void
+                {
+                    a_handler(a_error, a_error ? std::string{} : std::move(*listing));
+                }
+            );
+        }
+    );
+}
+
+auto client::start_list_directory(
+    std::string const& a_pathname,
+    listing_completion_handler a_handler
+)
+-> void
+{
+    start_listing_transfer(
+        a_pathname,
+        [this, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection,
+            bool a_mlsd
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            receive_listing(a_data_transfer_connection, a_mlsd, a_handler);
+        }
+    );
+}
+
+auto client::start_list_directory(
+    std::string const& a_pathname,
+    std::function<void(listing_entry const&)> a_entry_callback,
+    completion_handler a_handler
+)
+-> void
+{
+    start_listing_transfer(
+        a_pathname,
+        [this, a_entry_callback, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection,
+            bool a_mlsd
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            // NOTE - Holds the last, incomplete line of what has been read so far.
+            auto pending = std::make_shared<std::vector<char>>();
+
+            receive_data(
+                a_data_transfer_connection,
+                [pending, a_mlsd, a_entry_callback](char const* a_data, std::size_t a_size)
+                -> void
+                {
+                    pending->insert(pending->end(), a_data, a_data + a_size);
+
+                    std::string_view rest{pending->data(), pending->size()};
+                    listing_entry entry;
+
+                    for (auto end = rest.find('\n');
+                         end != std::string_view::npos;
+                         end = rest.find('\n'))
+                    {
+                        if (parse_listing_line(rest.substr(0, end), a_mlsd, entry))
+                        {
+                            a_entry_callback(entry);
+                        }
+
+                        rest.remove_prefix(end + 1);
+                    }
+
+                    auto const consumed{pending->size() - rest.size()};
+                    pending->erase(
+                        pending->begin(),
+                        pending->begin() + static_cast<std::ptrdiff_t>(consumed)
+                    );
+                },
+                std::numeric_limits<std::size_t>::max(),
+                [pending, a_mlsd, a_entry_callback, a_handler](std::exception_ptr a_error) -> void
+                {
+                    listing_entry entry;
+
+                    if (!a_error && parse_listing_line(
+                        std::string_view{pending->data(), pending->size()},
+                        a_mlsd,
+                        entry
+                    ))
+                    {
+                        try
+                        {
+                            a_entry_callback(entry);
+                        } catch (...)
+                        {
+                            a_error = std::current_exception();
+                        }
+                    }
+
+                    a_handler(a_error);
+                }
+            );
+        }
+    );
+}
+
+auto client::start_listing_transfer(
+    std::string const& a_pathname,
+    listing_transfer_handler a_handler
+)
+-> void
+{
+    if (m_mlsd_unsupported)
+    {
+        start_data_transfer(
+            list_command(a_pathname),
+            [a_handler](
+                std::exception_ptr a_error,
+                std::shared_ptr<connection> a_data_transfer_connection
+            ) -> void
+            {
+                a_handler(a_error, a_data_transfer_connection, false);
             }
         );
-
-        start_timer();
-        run_event_loop();
-        handle_error();
+        return;
     }
 
-    auto write(char const* a_buf, int a_buf_size)
-    -> void
-    {
-        if (!m_socket.is_open())
+    start_data_transfer(
+        mlsd_command(a_pathname),
+        [this, a_pathname, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
         {
-            throw std::logic_error("Writing to socket that is not connected");
+            if (a_error && is_not_implemented(a_error) && is_open())
+            {
+                // NOTE - Pre RFC3659 server - use LIST for the rest of the session.
+                m_mlsd_unsupported = true;
+                start_listing_transfer(a_pathname, a_handler);
+                return;
+            }
+
+            a_handler(a_error, a_data_transfer_connection, true);
         }
+    );
+}
 
-        boost::asio::async_write(
-            m_socket,
-            boost::asio::buffer(a_buf, a_buf_size),
-            [this](
-                boost::system::error_code const& a_ec,
-                [[ maybe_unused ]] size_t a_bytes_transferred
-            ) -> void
-            {
-                boost::system::error_code ignored_ec;
-                m_timer.cancel(ignored_ec);
+auto client::receive_listing(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    bool a_mlsd,
+    listing_completion_handler a_handler
+)
+-> void
+{
+    auto buffer = std::make_shared<std::vector<char>>();
 
-                if (a_ec && a_ec != boost::asio::error::operation_aborted)
-                {
-                    m_ec = a_ec;
-                }
+    receive_data(
+        a_data_transfer_connection,
+        [buffer](char const* a_data, std::size_t a_size) -> void
+        {
+            buffer->insert(buffer->end(), a_data, a_data + a_size);
+        },
+        std::numeric_limits<std::size_t>::max(),
+        [buffer, a_mlsd, a_handler](std::exception_ptr a_error) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
             }
-        );
 
-        start_timer();
-        run_event_loop();
-        handle_error();
-    }
+            std::vector<listing_entry> entries;
 
-    auto is_open() noexcept -> bool
-    {
-        return m_socket.is_open();
-    }
-};
+            try
+            {
+                entries = parse_listing(*buffer, a_mlsd);
+            } catch (...)
+            {
+                a_handler(std::current_exception(), {});
+                return;
+            }
 
-client::connection::connection() :
-    m_impl(std::make_unique<client::connection::impl>())
-{ }
+            // NOTE - Moving the vector keeps its storage, the entries stay valid.
+            a_handler(nullptr, directory_listing(std::move(*buffer), std::move(entries)));
+        }
+    );
+}
 
-client::connection::~connection() noexcept
+auto client::start_size(
+    std::string const& a_filepath,
+    size_completion_handler a_handler
+)
+-> void
 {
-    if (is_open())
-    {
-        try
-        {
-            close();
-        } catch (std::exception const& e)
+    send_command(
+        size_command(a_filepath),
+        {reply_code::FILE_STATUS_213},
+        [a_handler](std::exception_ptr a_error, std::string a_reply) -> void
         {
-            logger::error(e.what());
+            if (a_error)
+            {
+                a_handler(a_error, 0);
+                return;
+            }
+
+            // NOTE - "213 <size>"
+            std::string_view text{a_reply};
+            std::size_t size{0};
+
+            text.remove_prefix(std::min<std::size_t>(text.size(), 4));
+
+            if (!consume_number(text, 20, size))
+            {
+                a_handler(
+                    std::make_exception_ptr(
+                        reply_error("Failed to parse SIZE reply", reply_code::FILE_STATUS_213)
+                    ),
+                    0
+                );
+                return;
+            }
+
+            a_handler(nullptr, size);
         }
-    }
+    );
 }
 
-auto client::connection::connect(
-    std::string const& a_host,
-    int a_port,
-    std::chrono::milliseconds const& a_timeout
-)
+auto client::start_system_info(string_completion_handler a_handler)
 -> void
 {
-    m_impl->connect(a_host, a_port, a_timeout);
+    send_command(
+        syst_command(),
+        {reply_code::X_SYSTEM_TYPE_215},
+        [a_handler](std::exception_ptr a_error, std::string a_reply) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            try
+            {
+                a_reply = reply_text(a_reply);
+            } catch (...)
+            {
+                a_handler(std::current_exception(), {});
+                return;
+            }
+
+            a_handler(nullptr, std::move(a_reply));
+        }
+    );
 }
 
-auto client::connection::close() -> void
+// TODO - Validate server response
+auto client::start_progress(string_completion_handler a_handler)
+-> void
 {
-    m_impl->close();
+    send_command(
+        stat_command(),
+        {
+            reply_code::SYSTEM_STATUS_211,
+            reply_code::DIRECTORY_STATUS_212,
+            reply_code::FILE_STATUS_213
+        },
+        [a_handler](std::exception_ptr a_error, std::string a_reply) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            try
+            {
+                a_reply = reply_text(a_reply);
+            } catch (...)
+            {
+                a_handler(std::current_exception(), {});
+                return;
+            }
+
+            a_handler(nullptr, std::move(a_reply));
+        }
+    );
 }
 
-auto client::connection::read(int a_max)
--> std::vector<char>
+auto client::start_features(features_completion_handler a_handler)
+-> void
 {
-    return m_impl->read(a_max);
+    send_command(
+        feat_command(),
+        {reply_code::SYSTEM_STATUS_211},
+        [this, a_handler](std::exception_ptr a_error, std::string a_reply) -> void
+        {
+            if (a_error)
+            {
+                if (is_not_implemented(a_error) && is_open())
+                {
+                    a_handler(nullptr, {});
+                    return;
+                }
+
+                a_handler(a_error, {});
+                return;
+            }
+
+            // NOTE - RFC2389 - every feature is on its own line, indented by a space, between
+            //        the "211-" and "211 " lines.
+            std::vector<std::string> features;
+            std::string_view rest{a_reply};
+
+            for (auto end = rest.find(CRLF); end != std::string_view::npos; end = rest.find(CRLF))
+            {
+                auto const line{rest.substr(0, end)};
+                rest.remove_prefix(end + CRLF.size());
+
+                if (!line.empty() && line.front() == ' ')
+                {
+                    features.emplace_back(line.substr(1));
+                }
+            }
+
+            a_handler(nullptr, std::move(features));
+        }
+    );
 }
 
-auto client::connection::read_until(std::string const& a_delimiter)
--> std::string
+auto client::start_noop(completion_handler a_handler)
+-> void
 {
-    auto result = m_impl->read_until(a_delimiter);
-    logger::debug(result);
-    return result;
+    send_command(
+        noop_command(),
+        {reply_code::OK_200},
+        [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply) -> void
+        {
+            a_handler(a_error);
+        }
+    );
 }
 
-auto client::connection::read_until(char a_delimiter)
--> std::string
+auto client::start_execute(
+    command_batch const& a_batch,
+    batch_completion_handler a_handler
+)
+-> void
 {
-    auto result = m_impl->read_until(a_delimiter);
-    logger::debug(result);
-    return result;
+    auto replies = std::make_shared<std::vector<command_reply>>();
+    replies->reserve(a_batch.size());
+
+    execute_window(std::make_shared<command_batch const>(a_batch), replies, std::move(a_handler));
 }
 
-auto client::connection::write(std::string const& a_buf)
+auto client::execute_window(
+    std::shared_ptr<command_batch const> a_batch,
+    std::shared_ptr<std::vector<command_reply>> a_replies,
+    batch_completion_handler a_handler
+)
 -> void
 {
-    logger::debug(a_buf);
-    m_impl->write(a_buf);
+    auto const window_begin = a_replies->size();
+
+    if (window_begin == a_batch->size())
+    {
+        boost::asio::post(m_io_context, [a_replies, a_handler]() -> void
+        {
+            a_handler(nullptr, std::move(*a_replies));
+        });
+        return;
+    }
+
+    auto const window_end = std::min(window_begin + PIPELINE_WINDOW, a_batch->size());
+
+    auto const begin = window_begin == 0 ? 0 : a_batch->m_commands[window_begin - 1].m_end;
+    auto const end = a_batch->m_commands[window_end - 1].m_end;
+
+    logger::debug(std::string_view{a_batch->m_buffer}.substr(begin, end - begin));
+
+    // NOTE - a_batch is kept alive by the handler, the window is written straight out of it.
+    m_control_connection.async_write(
+        a_batch->m_buffer.data() + begin,
+        static_cast<int>(end - begin),
+        [this, a_batch, a_replies, window_end, a_handler](std::exception_ptr a_error) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            read_batch_reply(a_batch, a_replies, window_end, a_handler);
+        }
+    );
 }
 
-auto client::connection::write(char const* a_buf, int a_buf_size)
+auto client::read_batch_reply(
+    std::shared_ptr<command_batch const> a_batch,
+    std::shared_ptr<std::vector<command_reply>> a_replies,
+    std::size_t a_window_end,
+    batch_completion_handler a_handler
+)
 -> void
 {
-    m_impl->write(a_buf, a_buf_size);
+    read_raw_reply([this, a_batch, a_replies, a_window_end, a_handler](
+        std::exception_ptr a_error,
+        std::string a_reply
+    ) -> void
+    {
+        if (a_error)
+        {
+            a_handler(a_error, {});
+            return;
+        }
+
+        command_reply reply;
+        try
+        {
+            check_success(a_batch->m_commands[a_replies->size()].m_accepted_codes, a_reply);
+        } catch (...)
+        {
+            reply.error = std::current_exception();
+        }
+        reply.reply = std::move(a_reply);
+        a_replies->push_back(std::move(reply));
+
+        if (a_replies->size() < a_window_end)
+        {
+            read_batch_reply(a_batch, a_replies, a_window_end, a_handler);
+        } else
+        {
+            execute_window(a_batch, a_replies, a_handler);
+        }
+    });
 }
 
-auto client::connection::is_open() noexcept
--> bool
+auto client::send_command(
+    command_line const& a_command,
+    reply_code_set a_accepted_codes,
+    string_completion_handler a_handler
+)
+-> void
 {
-    return m_impl->is_open();
+    m_control_connection.async_write(
+        a_command,
+        [this, a_accepted_codes, a_handler](std::exception_ptr a_error) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, {});
+                return;
+            }
+
+            read_reply(a_accepted_codes, a_handler);
+        }
+    );
 }
 
-static auto set_log_level(bool a_debug) -> void
+auto client::read_raw_reply(string_completion_handler a_handler)
+-> void
 {
-    if (a_debug)
-    {
-        logger::set_log_level(log_level::DEBUG);
-    } else
-    {
-        logger::set_log_level(log_level::ERROR);
-    }
+    m_control_connection.async_read_reply(
+        [this, a_handler](std::exception_ptr a_error, std::string a_reply) -> void
+        {
+            // NOTE - The server is gone or about to close the control connection (RFC959 421).
+            if ((a_error && is_end_of_file(a_error)) || is_service_not_available(a_reply))
+            {
+                m_control_connection.abort();
+            }
+
+            a_handler(a_error, a_error ? std::string{} : std::move(a_reply));
+        }
+    );
 }
 
-client::client(connection_options const& a_opts) :
-    m_options(a_opts)
+auto client::read_reply(
+    reply_code_set a_accepted_codes,
+    string_completion_handler a_handler
+)
+-> void
 {
-    assert(!a_opts.server_hostname.empty() && "empty hostname");
-    assert(a_opts.server_port > 0 && "negative server port");
+    read_raw_reply([a_accepted_codes, a_handler](std::exception_ptr a_error, std::string a_reply)
+    -> void
+    {
+        if (a_error)
+        {
+            a_handler(a_error, {});
+            return;
+        }
 
-    set_log_level(a_opts.debug_output);
+        try
+        {
+            check_success(a_accepted_codes, a_reply);
+        } catch (...)
+        {
+            a_handler(std::current_exception(), {});
+            return;
+        }
+
+        a_handler(nullptr, std::move(a_reply));
+    });
 }
 
-auto client::set_connection_options(connection_options const& a_opts) noexcept
+auto client::start_retrieve(
+    std::string const& a_filename,
+    data_connection_handler a_handler
+)
 -> void
 {
-    m_options = a_opts;
-    set_log_level(a_opts.debug_output);
+    start_data_transfer(retr_command(a_filename), std::move(a_handler));
 }
 
-auto client::connect()
+auto client::finish_download(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    std::exception_ptr a_read_error,
+    completion_handler a_handler
+)
 -> void
 {
-    m_control_connection.connect(
-        m_options.server_hostname,
-        m_options.server_port,
-        m_options.timeout
-    );
+    if (!is_end_of_file(a_read_error))
+    {
+        abort_transfer(a_data_transfer_connection, a_read_error, a_handler);
+        return;
+    }
 
-    check_success(
+    read_reply(
         {
-            reply_code::OK_200,
-            reply_code::READY_FOR_NEW_USER_220
+            reply_code::CLOSING_DATA_CONNECTION_226,
+            reply_code::FILE_ACTION_COMPLETED_250
         },
-        m_control_connection.read_until(CRLF)
+        [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply) -> void
+        {
+            a_handler(a_error);
+        }
     );
 }
 
-auto client::connect(
-    std::string const& a_hostname,
-    int a_port
+auto client::download_passive(
+    std::string const& a_filename,
+    std::function<void(char const*, std::size_t)> a_data_callback,
+    completion_handler a_handler
 )
 -> void
 {
-    m_control_connection.connect(
-        a_hostname,
-        a_port,
-        m_options.timeout
-    );
-
-    check_success(
+    start_retrieve(
+        a_filename,
+        [this, a_data_callback, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
         {
-            reply_code::OK_200,
-            reply_code::READY_FOR_NEW_USER_220
-        },
-        m_control_connection.read_until(CRLF)
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            receive_data(
+                a_data_transfer_connection,
+                a_data_callback,
+                std::numeric_limits<std::size_t>::max(),
+                a_handler
+            );
+        }
     );
 }
 
-auto client::close()
+auto client::download_range(
+    std::string const& a_filename,
+    std::size_t a_offset,
+    std::size_t a_length,
+    std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+    completion_handler a_handler
+)
 -> void
 {
-    if (m_control_connection.is_open())
+    if (a_length == 0)
     {
-        m_control_connection.write(quit_command());
-        check_success(
-            {reply_code::CLOSING_CONTROL_CONNECTION_221},
-            m_control_connection.read_until(CRLF)
-        );
-        m_control_connection.close();
+        boost::asio::post(m_io_context, [a_handler]() -> void
+        {
+            a_handler(nullptr);
+        });
+        return;
     }
+
+    start_data_transfer(
+        retr_command(a_filename),
+        a_offset,
+        [this, a_offset, a_length, a_data_callback, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            auto offset = std::make_shared<std::size_t>(a_offset);
+
+            // NOTE - A server may end the transfer early with a 226 - the range is then short
+            //        and the bytes the caller expects there were never written.
+            receive_data(
+                a_data_transfer_connection,
+                [offset, a_data_callback](char const* a_data, std::size_t a_size) -> void
+                {
+                    a_data_callback(*offset, a_data, a_size);
+                    *offset += a_size;
+                },
+                a_length,
+                [offset, a_offset, a_length, a_handler](std::exception_ptr a_error) -> void
+                {
+                    auto const received{*offset - a_offset};
+
+                    if (!a_error && received != a_length)
+                    {
+                        a_error = std::make_exception_ptr(std::runtime_error(
+                            "Range transfer ended after " + std::to_string(received) + " of " +
+                            std::to_string(a_length) + " bytes"
+                        ));
+                    }
+
+                    a_handler(a_error);
+                }
+            );
+        }
+    );
 }
 
-auto client::login()
+auto client::upload_range(
+    std::string const& a_filename,
+    std::istream& a_istream,
+    std::size_t a_offset,
+    std::size_t a_length,
+    completion_handler a_started_handler,
+    completion_handler a_handler
+)
 -> void
 {
-    m_control_connection.write(user_command(m_options.username));
-    check_success(
+    start_data_transfer(
+        stor_command(a_filename),
+        a_offset,
+        [this, &a_istream, a_length, a_started_handler, a_handler](
+            std::exception_ptr a_error,
+            std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
         {
-            reply_code::USER_LOGGED_IN_230,
-            reply_code::USERNAME_OK_NEED_PASSWORD_331,
-            reply_code::NEED_ACCOUNT_332
-        },
-        m_control_connection.read_until(CRLF)
-    );
-    m_control_connection.write(password_command(m_options.password));
-    check_success(
-        {reply_code::USER_LOGGED_IN_230},
-        m_control_connection.read_until(CRLF)
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            a_started_handler(nullptr);
+
+            send_data(
+                a_data_transfer_connection,
+                a_istream,
+                std::make_shared<std::vector<char>>(8192),
+                a_length,
+                a_handler
+            );
+        }
     );
 }
 
-auto client::login(
-    std::string const& a_username,
-    std::string const& a_password
+auto client::receive_data(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    std::function<void(char const*, std::size_t)> a_data_callback,
+    std::size_t a_remaining,
+    completion_handler a_handler
 )
 -> void
 {
-    m_control_connection.write(user_command(a_username));
-    check_success(
-        {
-            reply_code::USER_LOGGED_IN_230,
-            reply_code::USERNAME_OK_NEED_PASSWORD_331,
-            reply_code::NEED_ACCOUNT_332
-        },
-        m_control_connection.read_until(CRLF)
-    );
-    m_control_connection.write(password_command(a_password));
-    check_success(
-        {reply_code::USER_LOGGED_IN_230},
-        m_control_connection.read_until(CRLF)
+    receive_data(
+        std::move(a_data_transfer_connection),
+        std::make_shared<std::vector<char>>(std::min<std::size_t>(65536, a_remaining)),
+        std::move(a_data_callback),
+        a_remaining,
+        std::move(a_handler)
     );
 }
 
-auto client::cwd(std::string const& a_new_wd)
+auto client::receive_data(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    std::shared_ptr<std::vector<char>> a_buf,
+    std::function<void(char const*, std::size_t)> a_data_callback,
+    std::size_t a_remaining,
+    completion_handler a_handler
+)
 -> void
 {
-    m_control_connection.write(cwd_command(a_new_wd));
-    check_success(
-        {reply_code::FILE_ACTION_COMPLETED_250},
-        m_control_connection.read_until(CRLF)
+    a_data_transfer_connection->async_read_some(
+        a_buf->data(),
+        std::min(a_buf->size(), a_remaining),
+        [this, a_data_transfer_connection, a_buf, a_data_callback, a_remaining, a_handler](
+            std::exception_ptr a_error,
+            std::size_t a_size
+        ) -> void
+        {
+            // TODO - Handle more transfer modes - default stream.
+            // NOTE - Default transfer mode - STREAM. When the server closes the connection - the
+            //        transfer is done.
+            if (a_error)
+            {
+                finish_download(a_data_transfer_connection, a_error, a_handler);
+                return;
+            }
+
+            try
+            {
+                a_data_callback(a_buf->data(), a_size);
+            } catch (...)
+            {
+                abort_transfer(a_data_transfer_connection, std::current_exception(), a_handler);
+                return;
+            }
+
+            auto const remaining = a_remaining - a_size;
+
+            if (remaining == 0)
+            {
+                // NOTE - Range transfer - the rest of the file is not needed. Depending on how
+                //        far it got, the server reports the cut short transfer as complete or
+                //        aborted.
+                a_data_transfer_connection->abort();
+                read_reply(
+                    {
+                        reply_code::CLOSING_DATA_CONNECTION_226,
+                        reply_code::FILE_ACTION_COMPLETED_250,
+                        reply_code::CONNECTION_CLOSED_TRANSFER_ABORTED_426,
+                        reply_code::ACTION_ABORTED_LOCAL_ERROR_451
+                    },
+                    [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply)
+                    -> void
+                    {
+                        a_handler(a_error);
+                    }
+                );
+                return;
+            }
+
+            receive_data(a_data_transfer_connection, a_buf, a_data_callback, remaining, a_handler);
+        }
     );
 }
 
-auto client::cdup()
+auto client::receive_to_end(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    std::shared_ptr<std::vector<char>> a_buf,
+    std::function<void(char const*, std::size_t)> a_data_callback,
+    completion_handler a_handler
+)
 -> void
 {
-    m_control_connection.write(cdup_command());
-    check_success(
+    a_data_transfer_connection->async_read_some(
+        a_buf->data(),
+        a_buf->size(),
+        [this, a_data_transfer_connection, a_buf, a_data_callback, a_handler](
+            std::exception_ptr a_error,
+            std::size_t a_size
+        ) -> void
         {
-            reply_code::OK_200,
-            reply_code::FILE_ACTION_COMPLETED_250
-        },
-        m_control_connection.read_until(CRLF)
+            // NOTE - Stream mode - the server closing the connection ends the file.
+            if (a_error)
+            {
+                a_handler(is_end_of_file(a_error) ? nullptr : a_error);
+                return;
+            }
+
+            try
+            {
+                a_data_callback(a_buf->data(), a_size);
+            } catch (...)
+            {
+                a_handler(std::current_exception());
+                return;
+            }
+
+            receive_to_end(a_data_transfer_connection, a_buf, a_data_callback, a_handler);
+        }
     );
 }
 
-auto client::download(std::string const& a_filename)
--> std::vector<char>
+auto client::receive_into(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    char* a_buf,
+    std::size_t a_size,
+    std::size_t a_received,
+    size_completion_handler a_handler
+)
+-> void
 {
-    std::vector<char> ret_data;
-
-    auto data_callback = [&ret_data](std::vector<char> const& a_data) -> void
+    if (a_received == a_size)
     {
-        std::copy(a_data.begin(), a_data.end(), std::back_inserter(ret_data));
-    };
+        boost::asio::post(m_io_context, [a_handler, a_received]() -> void
+        {
+            a_handler(nullptr, a_received);
+        });
+        return;
+    }
+
+    a_data_transfer_connection->async_read_some(
+        a_buf + a_received,
+        a_size - a_received,
+        [this, a_data_transfer_connection, a_buf, a_size, a_received, a_handler](
+            std::exception_ptr a_error,
+            std::size_t a_read
+        ) -> void
+        {
+            if (a_error)
+            {
+                if (!is_end_of_file(a_error))
+                {
+                    abort_transfer(
+                        a_data_transfer_connection,
+                        a_error,
+                        [a_handler](std::exception_ptr a_error) -> void
+                        {
+                            a_handler(a_error, 0);
+                        }
+                    );
+                    return;
+                }
 
-    download_passive(a_filename, data_callback);
+                read_reply(
+                    {
+                        reply_code::CLOSING_DATA_CONNECTION_226,
+                        reply_code::FILE_ACTION_COMPLETED_250
+                    },
+                    [a_received, a_handler](
+                        std::exception_ptr a_error,
+                        [[ maybe_unused ]] std::string a_reply
+                    ) -> void
+                    {
+                        a_handler(a_error, a_received);
+                    }
+                );
+                return;
+            }
 
-    return ret_data;
+            receive_into(a_data_transfer_connection, a_buf, a_size, a_received + a_read, a_handler);
+        }
+    );
 }
 
-auto client::download(
-    std::string const& a_filename,
-    std::ofstream& a_ofstream
+auto client::abort_transfer(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    std::exception_ptr a_error,
+    completion_handler a_handler
 )
 -> void
 {
-    auto data_callback = [&a_ofstream](std::vector<char> const& a_data) -> void
-    {
-        a_ofstream.write(reinterpret_cast<char const*>(a_data.data()), a_data.size());
-    };
+    a_data_transfer_connection->abort();
 
-    download_passive(a_filename, data_callback);
+    // NOTE - The transfer reply still has to be read for the control connection to stay usable,
+    //        whatever it says the error of the transfer is reported.
+    read_raw_reply([a_error, a_handler](
+        [[ maybe_unused ]] std::exception_ptr a_reply_error,
+        [[ maybe_unused ]] std::string a_reply
+    ) -> void
+    {
+        a_handler(a_error);
+    });
 }
 
-auto client::upload(
-    std::string const& a_filename,
-    std::istream& a_istream
+auto client::send_data(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    std::istream& a_istream,
+    std::shared_ptr<std::vector<char>> a_buf,
+    std::size_t a_remaining,
+    completion_handler a_handler
 )
 -> void
 {
-    connection data_transfer_connection;
-    enter_passive_mode(data_transfer_connection);
-    m_control_connection.write(stor_command(a_filename));
-    check_success(
-        {
-            reply_code::DATA_CONNECTION_OPEN_TRANSFER_STARTING_125,
-            reply_code::FILE_STATUS_OK_OPENING_DATA_CONNECTION_150
-        },
-        m_control_connection.read_until(CRLF)
-    );
-
-    char buf[8192];
-    while (!a_istream.eof())
+    if (a_istream.eof() || a_remaining == 0)
     {
-        a_istream.read(buf, 8192);
-        data_transfer_connection.write(buf, a_istream.gcount());
+        finish_upload(a_data_transfer_connection, std::move(a_handler));
+        return;
     }
 
-    data_transfer_connection.close();
+    a_istream.read(a_buf->data(), std::min(a_buf->size(), a_remaining));
+    auto const read = static_cast<std::size_t>(a_istream.gcount());
 
-    check_success(
+    // NOTE - A stream that fails without reaching its end would otherwise be read forever.
+    if (read == 0)
+    {
+        if (a_istream.bad())
         {
-            reply_code::CLOSING_DATA_CONNECTION_226,
-            reply_code::FILE_ACTION_COMPLETED_250
-        },
-        m_control_connection.read_until(CRLF)
+            abort_transfer(
+                a_data_transfer_connection,
+                std::make_exception_ptr(std::runtime_error("Reading the stream to upload failed")),
+                std::move(a_handler)
+            );
+            return;
+        }
+
+        finish_upload(a_data_transfer_connection, std::move(a_handler));
+        return;
+    }
+
+    a_data_transfer_connection->async_write(
+        a_buf->data(),
+        static_cast<int>(read),
+        [this, a_data_transfer_connection, &a_istream, a_buf, a_remaining, read, a_handler](
+            std::exception_ptr a_error
+        ) -> void
+        {
+            if (a_error)
+            {
+                abort_transfer(a_data_transfer_connection, a_error, a_handler);
+                return;
+            }
+
+            send_data(
+                a_data_transfer_connection,
+                a_istream,
+                a_buf,
+                a_remaining - read,
+                a_handler
+            );
+        }
     );
 }
 
-auto client::rename(
-    std::string const& a_file_to_rename,
-    std::string const& a_rename_to
+auto client::finish_upload(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    completion_handler a_handler
 )
 -> void
 {
-    m_control_connection.write(rnfr_command(a_file_to_rename));
-    check_success(
-        {reply_code::REQUESTED_FILE_ACTION_INFO_PENDING_350},
-        m_control_connection.read_until(CRLF)
-    );
-    m_control_connection.write(rnto_command(a_rename_to));
-    check_success(
-        {reply_code::FILE_ACTION_COMPLETED_250},
-        m_control_connection.read_until(CRLF)
-    );
-}
+    try
+    {
+        a_data_transfer_connection->close();
+    } catch (...)
+    {
+        a_handler(std::current_exception());
+        return;
+    }
 
-auto client::remove_file(std::string const& a_filepath)
--> void
-{
-    m_control_connection.write(dele_command(a_filepath));
-    check_success(
-        {reply_code::FILE_ACTION_COMPLETED_250},
-        m_control_connection.read_until(CRLF)
+    read_reply(
+        {
+            reply_code::CLOSING_DATA_CONNECTION_226,
+            reply_code::FILE_ACTION_COMPLETED_250
+        },
+        [a_handler](std::exception_ptr a_error, [[ maybe_unused ]] std::string a_reply) -> void
+        {
+            a_handler(a_error);
+        }
     );
 }
 
-auto client::rmdir(std::string const& a_dirpath)
+auto client::start_data_transfer(
+    command_line const& a_command,
+    data_connection_handler a_handler
+)
 -> void
 {
-    m_control_connection.write(rmd_command(a_dirpath));
-    check_success(
-        {reply_code::FILE_ACTION_COMPLETED_250},
-        m_control_connection.read_until(CRLF)
-    );
+    start_data_transfer(a_command, 0, std::move(a_handler));
 }
 
-auto client::mkdir(std::string const& a_dirpath)
+auto client::start_data_transfer(
+    command_line const& a_command,
+    std::size_t a_restart_offset,
+    data_connection_handler a_handler
+)
 -> void
 {
-    m_control_connection.write(mkd_command(a_dirpath));
-    check_success(
-        {reply_code::PATHNAME_CREATED_257},
-        m_control_connection.read_until(CRLF)
+    // NOTE - The transfer command is sent after EPSV, past the lifetime of its arguments.
+    enter_passive_mode(
+        [this, command = a_command.str(), a_restart_offset, a_handler](
+            std::exception_ptr a_error,
+            std::string a_reply
+        ) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error, nullptr);
+                return;
+            }
+
+            open_data_transfer(a_reply, command, a_restart_offset, a_handler);
+        }
     );
 }
 
-auto client::pwd()
--> std::string
+auto client::make_data_connection()
+-> std::shared_ptr<connection>
 {
-    m_control_connection.write(pwd_command());
-    auto response = m_control_connection.read_until(CRLF);
-    check_success(
-        {reply_code::PATHNAME_CREATED_257},
-        response
-    );
+    auto data_transfer_connection = std::make_shared<connection>(m_io_context);
+    data_transfer_connection->set_socket_options(m_options.data_socket);
 
-    if (response.size() > 4)
+    if (m_options.transfer_timeout.count() > 0)
     {
-        auto ret{response.substr(4)};
-        logger::debug(ret);
-        return ret;
+        data_transfer_connection->set_deadline(
+            std::chrono::steady_clock::now() + m_options.transfer_timeout
+        );
     }
 
-    throw std::length_error("Server returned malformed response");
+    return data_transfer_connection;
 }
 
-auto client::ls()
--> std::string
+auto client::send_transfer_command(
+    std::shared_ptr<connection> a_data_transfer_connection,
+    std::string a_command,
+    std::size_t a_restart_offset,
+    data_connection_handler a_handler
+)
+-> void
 {
-    connection data_transfer_connection;
-    enter_passive_mode(data_transfer_connection);
-    m_control_connection.write(nlst_command());
-    check_success(
-        {
-            reply_code::DATA_CONNECTION_OPEN_TRANSFER_STARTING_125,
-            reply_code::FILE_STATUS_OK_OPENING_DATA_CONNECTION_150
-        },
-        m_control_connection.read_until(CRLF)
-    );
-    auto response = data_transfer_connection.read_until(CRLF);
-    check_success(
+    auto transfer = [this, a_data_transfer_connection, a_command, a_handler]() -> void
+    {
+        send_command(
+            command_line(a_command),
+            {
+                reply_code::DATA_CONNECTION_OPEN_TRANSFER_STARTING_125,
+                reply_code::FILE_STATUS_OK_OPENING_DATA_CONNECTION_150
+            },
+            [a_data_transfer_connection, a_handler](
+                std::exception_ptr a_error,
+                [[ maybe_unused ]] std::string a_reply
+            ) -> void
+            {
+                a_handler(a_error, a_error ? nullptr : a_data_transfer_connection);
+            }
+        );
+    };
+
+    if (a_restart_offset == 0)
+    {
+        transfer();
+        return;
+    }
+
+    // NOTE - RFC3659 - REST has to be the last command before the transfer command.
+    send_command(
+        rest_command(a_restart_offset),
+        {reply_code::REQUESTED_FILE_ACTION_INFO_PENDING_350},
+        [transfer, a_handler](
+            std::exception_ptr a_error,
+            [[ maybe_unused ]] std::string a_reply
+        ) -> void
         {
-            reply_code::CLOSING_DATA_CONNECTION_226,
-            reply_code::FILE_ACTION_COMPLETED_250
-        },
-        m_control_connection.read_until(CRLF)
+            if (a_error)
+            {
+                a_handler(a_error, nullptr);
+                return;
+            }
+
+            transfer();
+        }
     );
-    return response;
 }
 
-auto client::ls(std::string const& a_pathname)
--> std::string
+static constexpr reply_code_set PASSIVE_MODE_CODES{
+    reply_code::OK_200,
+    reply_code::ENTERING_PASSIVE_MODE_227,
+    reply_code::ENTERING_EXTENDED_PASSIVE_MODE_229,
+};
+
+auto client::enter_passive_mode(string_completion_handler a_handler) -> void
 {
-    connection data_transfer_connection;
-    enter_passive_mode(data_transfer_connection);
-    m_control_connection.write(nlst_command(a_pathname));
-    check_success(
-        {
-            reply_code::DATA_CONNECTION_OPEN_TRANSFER_STARTING_125,
-            reply_code::FILE_STATUS_OK_OPENING_DATA_CONNECTION_150
-        },
-        m_control_connection.read_until(CRLF)
-    );
-    auto response = data_transfer_connection.read_until(CRLF);
-    check_success(
-        {
-            reply_code::CLOSING_DATA_CONNECTION_226,
-            reply_code::FILE_ACTION_COMPLETED_250
-        },
-        m_control_connection.read_until(CRLF)
-    );
-    return response;
+    send_command(epsv_command(), PASSIVE_MODE_CODES, std::move(a_handler));
 }
 
-auto client::system_info()
--> std::string
+auto client::read_passive_mode_reply(string_completion_handler a_handler) -> void
 {
-    m_control_connection.write(syst_command());
-    auto response = m_control_connection.read_until(CRLF);
-    check_success(
-        {reply_code::X_SYSTEM_TYPE_215},
-        response
-    );
-
-    if (response.size() > 4)
-    {
-        auto ret{response.substr(4)};
-        logger::debug(ret);
-        return ret;
-    }
-
-    throw std::length_error("Server returned malformed response");
+    read_reply(PASSIVE_MODE_CODES, std::move(a_handler));
 }
 
-// TODO - Validate server response
-auto client::progress()
--> std::string
+auto client::skip_replies(
+    std::exception_ptr a_error,
+    std::size_t a_count,
+    completion_handler a_handler
+)
+-> void
 {
-    m_control_connection.write(stat_command());
-    auto response = m_control_connection.read_until(CRLF);
-    check_success(
-        {
-            reply_code::DIRECTORY_STATUS_212,
-            reply_code::FILE_STATUS_213
-        },
-        response
-    );
-
-    if (response.size() > 4)
+    if (a_count == 0 || !is_open())
     {
-        auto ret{response.substr(4)};
-        logger::debug(ret);
-        return ret;
+        a_handler(a_error);
+        return;
     }
 
-    throw std::length_error("Server returned malformed response");
-}
+    read_raw_reply([this, a_error, a_count, a_handler](
+        std::exception_ptr a_reply_error,
+        [[ maybe_unused ]] std::string a_reply
+    ) -> void
+    {
+        if (a_reply_error)
+        {
+            a_handler(a_error);
+            return;
+        }
 
-auto client::noop()
--> void
-{
-    m_control_connection.write(noop_command());
-    check_success(
-        {reply_code::OK_200},
-        m_control_connection.read_until(CRLF)
-    );
+        skip_replies(a_error, a_count - 1, a_handler);
+    });
 }
 
-auto client::download_passive(
-    std::string const& a_filename,
-    std::function<void(std::vector<char> const&)> a_data_callback
+auto client::open_data_transfer(
+    std::string const& a_passive_mode_reply,
+    std::string a_command,
+    std::size_t a_restart_offset,
+    data_connection_handler a_handler
 )
 -> void
 {
+    struct join
+    {
+        std::exception_ptr connect_error{};
+        std::exception_ptr command_error{};
+        int pending{2};
+    };
 
-    connection data_transfer_connection;
-    enter_passive_mode(data_transfer_connection);
-    m_control_connection.write(retr_command(a_filename));
-    check_success(
-        {
-            reply_code::DATA_CONNECTION_OPEN_TRANSFER_STARTING_125,
-            reply_code::FILE_STATUS_OK_OPENING_DATA_CONNECTION_150
-        },
-        m_control_connection.read_until(CRLF)
-    );
+    epsv_reply reply;
 
-    // TODO - Handle more transfer modes - default stream.
-    // NOTE - Default transfer mode - STREAM. When the server closes the connection - the transfer
-    //        is done.
-    while (true)
+    try
     {
-        try
+        reply = parse_epsv_reply(a_passive_mode_reply);
+    } catch (...)
+    {
+        a_handler(std::current_exception(), nullptr);
+        return;
+    }
+
+    auto data_transfer_connection = make_data_connection();
+    auto state = std::make_shared<join>();
+
+    auto done = [this, data_transfer_connection, state, a_handler]() -> void
+    {
+        if (--state->pending > 0)
+        {
+            return;
+        }
+
+        if (state->command_error)
+        {
+            data_transfer_connection->abort();
+            a_handler(state->command_error, nullptr);
+        } else if (state->connect_error)
         {
-            a_data_callback(data_transfer_connection.read(65536));
-        } catch (end_of_file_error const& e)
+            // NOTE - The server accepted the transfer command and waits for the data connection
+            //        until it gives up and replies, that reply has to be read.
+            abort_transfer(
+                data_transfer_connection,
+                state->connect_error,
+                [a_handler](std::exception_ptr a_error) -> void
+                {
+                    a_handler(a_error, nullptr);
+                }
+            );
+        } else
         {
-            break;
+            a_handler(nullptr, data_transfer_connection);
         }
-    }
+    };
 
-    check_success(
-        {reply_code::CLOSING_DATA_CONNECTION_226},
-        m_control_connection.read_until(CRLF)
+    // NOTE - The server accepts the data connection whenever it arrives, so it is connected while
+    //        the transfer command is on its way instead of before it is sent. EPSV replies carry
+    //        no address (RFC2428), the one of the control connection is used.
+    data_transfer_connection->async_connect(
+        m_control_connection,
+        reply.port,
+        m_options,
+        [state, done](std::exception_ptr a_error) -> void
+        {
+            state->connect_error = a_error;
+            done();
+        }
     );
-}
-
-auto client::enter_passive_mode(connection& a_data_transfer_connection)
--> void
-{
-    m_control_connection.write(epsv_command());
-    auto response = m_control_connection.read_until(CRLF);
-    check_success(
+    send_transfer_command(
+        data_transfer_connection,
+        std::move(a_command),
+        a_restart_offset,
+        [state, done](
+            std::exception_ptr a_error,
+            [[ maybe_unused ]] std::shared_ptr<connection> a_data_transfer_connection
+        ) -> void
         {
-            reply_code::OK_200,
-            reply_code::ENTERING_PASSIVE_MODE_227,
-            reply_code::ENTERING_EXTENDED_PASSIVE_MODE_229,
-        },
-        response);
-    auto reply = parse_epsv_reply(response);
-    a_data_transfer_connection.connect(
-        m_options.server_hostname,
-        reply.port,
-        m_options.timeout
+            state->command_error = a_error;
+            done();
+        }
     );
 }
 
 }   // namespace ftp
 }   // namespace rs
-
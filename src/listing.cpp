@@ -0,0 +1,529 @@
+#include <ftp/listing.hpp>
+
+#include <array>
+#include <ctime>
+
+
+namespace rs
+{
+namespace ftp
+{
+
+static auto to_lower(char a_char) noexcept -> char
+{
+    return a_char >= 'A' && a_char <= 'Z' ? static_cast<char>(a_char - 'A' + 'a') : a_char;
+}
+
+static auto iequals(
+    std::string_view a_lhs,
+    std::string_view a_rhs
+)
+noexcept -> bool
+{
+    if (a_lhs.size() != a_rhs.size())
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < a_lhs.size(); ++i)
+    {
+        if (to_lower(a_lhs[i]) != to_lower(a_rhs[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static auto is_digit(char a_char) noexcept -> bool
+{
+    return a_char >= '0' && a_char <= '9';
+}
+
+static auto parse_number(
+    std::string_view a_str,
+    std::uint64_t& a_number
+)
+noexcept -> bool
+{
+    if (a_str.empty())
+    {
+        return false;
+    }
+
+    a_number = 0;
+    for (auto c : a_str)
+    {
+        if (!is_digit(c))
+        {
+            return false;
+        }
+
+        a_number = a_number * 10 + static_cast<std::uint64_t>(c - '0');
+    }
+
+    return true;
+}
+
+// NOTE - Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's days_from_civil).
+static auto days_from_civil(
+    std::int64_t a_year,
+    unsigned a_month,
+    unsigned a_day
+)
+noexcept -> std::int64_t
+{
+    a_year -= a_month <= 2;
+    auto const era{(a_year >= 0 ? a_year : a_year - 399) / 400};
+    auto const yoe{static_cast<unsigned>(a_year - era * 400)};
+    auto const doy{(153 * (a_month + (a_month > 2 ? -3 : 9)) + 2) / 5 + a_day - 1};
+    auto const doe{yoe * 365 + yoe / 4 - yoe / 100 + doy};
+
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+static auto make_time_point(
+    std::int64_t a_year,
+    unsigned a_month,
+    unsigned a_day,
+    unsigned a_hour,
+    unsigned a_minute,
+    unsigned a_second
+)
+noexcept -> std::chrono::system_clock::time_point
+{
+    auto const seconds{
+        days_from_civil(a_year, a_month, a_day) * 86400 +
+        a_hour * 3600 + a_minute * 60 + a_second
+    };
+
+    return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+}
+
+// NOTE - RFC3659 time-val - YYYYMMDDHHMMSS[.sss], always UTC.
+static auto parse_time_val(
+    std::string_view a_str,
+    std::chrono::system_clock::time_point& a_time
+)
+noexcept -> bool
+{
+    std::uint64_t year{0};
+    std::uint64_t month{0};
+    std::uint64_t day{0};
+    std::uint64_t hour{0};
+    std::uint64_t minute{0};
+    std::uint64_t second{0};
+
+    if (a_str.size() < 14 ||
+        !parse_number(a_str.substr(0, 4), year) ||
+        !parse_number(a_str.substr(4, 2), month) ||
+        !parse_number(a_str.substr(6, 2), day) ||
+        !parse_number(a_str.substr(8, 2), hour) ||
+        !parse_number(a_str.substr(10, 2), minute) ||
+        !parse_number(a_str.substr(12, 2), second) ||
+        month < 1 || month > 12 || day < 1 || day > 31)
+    {
+        return false;
+    }
+
+    a_time = make_time_point(static_cast<std::int64_t>(year), month, day, hour, minute, second);
+    return true;
+}
+
+static auto parse_month(std::string_view a_str) noexcept -> unsigned
+{
+    static constexpr std::array<std::string_view, 12> months{
+        "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"
+    };
+
+    for (std::size_t i = 0; i < months.size(); ++i)
+    {
+        if (iequals(a_str, months[i]))
+        {
+            return static_cast<unsigned>(i + 1);
+        }
+    }
+
+    return 0;
+}
+
+static auto current_year_month(
+    std::int64_t& a_year,
+    unsigned& a_month
+)
+noexcept -> void
+{
+    auto const now{std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())};
+    std::tm tm{};
+    gmtime_r(&now, &tm);
+
+    a_year = tm.tm_year + 1900;
+    a_month = static_cast<unsigned>(tm.tm_mon + 1);
+}
+
+// NOTE - Splits off the next blank separated field, a_rest starts at the following field.
+static auto next_field(std::string_view& a_rest) noexcept -> std::string_view
+{
+    auto const begin{a_rest.find_first_not_of(' ')};
+
+    if (begin == std::string_view::npos)
+    {
+        a_rest = {};
+        return {};
+    }
+
+    auto const end{a_rest.find(' ', begin)};
+    auto const field{a_rest.substr(begin, end == std::string_view::npos ? end : end - begin)};
+
+    a_rest = end == std::string_view::npos ? std::string_view{} : a_rest.substr(end);
+    auto const next{a_rest.find_first_not_of(' ')};
+    a_rest = next == std::string_view::npos ? std::string_view{} : a_rest.substr(next);
+
+    return field;
+}
+
+static auto is_dot_entry(std::string_view a_name) noexcept -> bool
+{
+    return a_name == "." || a_name == "..";
+}
+
+auto parse_mlsd_line(
+    std::string_view a_line,
+    listing_entry& a_entry
+)
+noexcept -> bool
+{
+    auto const separator{a_line.find(' ')};
+
+    if (separator == std::string_view::npos || separator + 1 >= a_line.size())
+    {
+        return false;
+    }
+
+    a_entry = listing_entry{};
+    a_entry.name = a_line.substr(separator + 1);
+
+    auto facts{a_line.substr(0, separator)};
+
+    while (!facts.empty())
+    {
+        auto const end{facts.find(';')};
+        auto const fact{facts.substr(0, end)};
+        facts = end == std::string_view::npos ? std::string_view{} : facts.substr(end + 1);
+
+        auto const equals{fact.find('=')};
+        if (equals == std::string_view::npos)
+        {
+            continue;
+        }
+
+        auto const key{fact.substr(0, equals)};
+        auto const value{fact.substr(equals + 1)};
+
+        if (iequals(key, "type"))
+        {
+            if (iequals(value, "file"))
+            {
+                a_entry.type = entry_type::FILE;
+            } else if (iequals(value, "dir"))
+            {
+                a_entry.type = entry_type::DIRECTORY;
+            } else if (iequals(value, "cdir") || iequals(value, "pdir"))
+            {
+                return false;
+            } else if (iequals(value.substr(0, 13), "OS.unix=slink"))
+            {
+                a_entry.type = entry_type::SYMLINK;
+            }
+        } else if (iequals(key, "size") || iequals(key, "sizd"))
+        {
+            std::uint64_t size{0};
+            if (parse_number(value, size))
+            {
+                a_entry.size = size;
+            }
+        } else if (iequals(key, "modify"))
+        {
+            std::chrono::system_clock::time_point modify;
+            if (parse_time_val(value, modify))
+            {
+                a_entry.modify = modify;
+            }
+        } else if (iequals(key, "perm"))
+        {
+            a_entry.permissions = value;
+        } else if (iequals(key, "unique"))
+        {
+            a_entry.unique = value;
+        }
+    }
+
+    return !is_dot_entry(a_entry.name);
+}
+
+// NOTE - "drwxr-xr-x 2 owner group 4096 Jan 01 10:00 name" - the group is missing on some servers,
+//        so the fields are anchored on the month.
+static auto parse_unix_list_line(
+    std::string_view a_line,
+    listing_entry& a_entry
+)
+noexcept -> bool
+{
+    auto rest{a_line};
+    auto const mode{next_field(rest)};
+
+    if (mode.size() < 10)
+    {
+        return false;
+    }
+
+    a_entry = listing_entry{};
+    a_entry.permissions = mode;
+
+    switch (mode[0])
+    {
+    case '-':
+        a_entry.type = entry_type::FILE;
+        break;
+    case 'd':
+        a_entry.type = entry_type::DIRECTORY;
+        break;
+    case 'l':
+        a_entry.type = entry_type::SYMLINK;
+        break;
+    default:
+        a_entry.type = entry_type::OTHER;
+        break;
+    }
+
+    std::string_view previous{};
+    unsigned month{0};
+
+    for (int field = 0; field < 5 && !rest.empty(); ++field)
+    {
+        auto const current{next_field(rest)};
+
+        if (field >= 2 && (month = parse_month(current)) != 0)
+        {
+            break;
+        }
+
+        previous = current;
+    }
+
+    std::uint64_t size{0};
+    std::uint64_t day{0};
+    auto const day_field{next_field(rest)};
+    auto const time_field{next_field(rest)};
+
+    if (month == 0 || rest.empty() || !parse_number(day_field, day) || day < 1 || day > 31)
+    {
+        return false;
+    }
+
+    if (parse_number(previous, size))
+    {
+        a_entry.size = size;
+    }
+
+    std::uint64_t year{0};
+    std::uint64_t hour{0};
+    std::uint64_t minute{0};
+
+    if (time_field.size() == 5 && time_field[2] == ':' &&
+        parse_number(time_field.substr(0, 2), hour) &&
+        parse_number(time_field.substr(3, 2), minute))
+    {
+        std::int64_t current_year{0};
+        unsigned current_month{0};
+        current_year_month(current_year, current_month);
+
+        a_entry.modify = make_time_point(
+            month > current_month + 1 ? current_year - 1 : current_year,
+            month,
+            static_cast<unsigned>(day),
+            static_cast<unsigned>(hour),
+            static_cast<unsigned>(minute),
+            0
+        );
+    } else if (parse_number(time_field, year))
+    {
+        a_entry.modify = make_time_point(
+            static_cast<std::int64_t>(year),
+            month,
+            static_cast<unsigned>(day),
+            0,
+            0,
+            0
+        );
+    }
+
+    a_entry.name = rest;
+
+    if (a_entry.type == entry_type::SYMLINK)
+    {
+        auto const arrow{rest.find(" -> ")};
+        if (arrow != std::string_view::npos)
+        {
+            a_entry.name = rest.substr(0, arrow);
+        }
+    }
+
+    return !is_dot_entry(a_entry.name);
+}
+
+// NOTE - "01-31-21  10:00AM       <DIR>          name" or "01-31-21  10:00AM  1234 name".
+static auto parse_dos_list_line(
+    std::string_view a_line,
+    listing_entry& a_entry
+)
+noexcept -> bool
+{
+    auto rest{a_line};
+    auto const date{next_field(rest)};
+    auto const time{next_field(rest)};
+    auto const size_or_dir{next_field(rest)};
+
+    std::uint64_t month{0};
+    std::uint64_t day{0};
+    std::uint64_t year{0};
+    std::uint64_t hour{0};
+    std::uint64_t minute{0};
+
+    if (date.size() < 8 || date[2] != '-' || date[5] != '-' ||
+        !parse_number(date.substr(0, 2), month) ||
+        !parse_number(date.substr(3, 2), day) ||
+        !parse_number(date.substr(6), year) ||
+        time.size() < 5 || time[2] != ':' ||
+        !parse_number(time.substr(0, 2), hour) ||
+        !parse_number(time.substr(3, 2), minute) ||
+        rest.empty() || month < 1 || month > 12 || day < 1 || day > 31)
+    {
+        return false;
+    }
+
+    a_entry = listing_entry{};
+
+    if (time.size() >= 7)
+    {
+        auto const pm{to_lower(time[5]) == 'p'};
+        hour = hour % 12 + (pm ? 12 : 0);
+    }
+
+    if (date.size() == 8)
+    {
+        year += year < 70 ? 2000 : 1900;
+    }
+
+    a_entry.modify = make_time_point(
+        static_cast<std::int64_t>(year),
+        static_cast<unsigned>(month),
+        static_cast<unsigned>(day),
+        static_cast<unsigned>(hour),
+        static_cast<unsigned>(minute),
+        0
+    );
+
+    std::uint64_t size{0};
+
+    if (iequals(size_or_dir, "<DIR>"))
+    {
+        a_entry.type = entry_type::DIRECTORY;
+    } else if (parse_number(size_or_dir, size))
+    {
+        a_entry.type = entry_type::FILE;
+        a_entry.size = size;
+    } else
+    {
+        return false;
+    }
+
+    a_entry.name = rest;
+
+    return !is_dot_entry(a_entry.name);
+}
+
+auto parse_list_line(
+    std::string_view a_line,
+    listing_entry& a_entry
+)
+noexcept -> bool
+{
+    if (a_line.empty())
+    {
+        return false;
+    }
+
+    if (is_digit(a_line[0]))
+    {
+        return parse_dos_list_line(a_line, a_entry);
+    }
+
+    return parse_unix_list_line(a_line, a_entry);
+}
+
+auto parse_listing_line(
+    std::string_view a_line,
+    bool a_mlsd,
+    listing_entry& a_entry
+)
+noexcept -> bool
+{
+    if (!a_line.empty() && a_line.back() == '\r')
+    {
+        a_line.remove_suffix(1);
+    }
+
+    return a_mlsd ? parse_mlsd_line(a_line, a_entry) : parse_list_line(a_line, a_entry);
+}
+
+auto is_safe_entry_name(std::string_view a_name) noexcept -> bool
+{
+    if (a_name.empty() || is_dot_entry(a_name) ||
+        a_name.find_first_of("/\\") != std::string_view::npos)
+    {
+        return false;
+    }
+
+#if defined(_WIN32)
+    // NOTE - Only a drive prefix, "C:", makes a name leave the directory - "a:b" is a plain name
+    //        everywhere else.
+    auto const drive{static_cast<char>(a_name.front() | 0x20)};
+
+    if (a_name.size() >= 2 && a_name[1] == ':' && drive >= 'a' && drive <= 'z')
+    {
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+auto parse_listing(
+    std::vector<char> const& a_buffer,
+    bool a_mlsd
+)
+-> std::vector<listing_entry>
+{
+    std::vector<listing_entry> entries;
+    std::string_view rest{a_buffer.data(), a_buffer.size()};
+    listing_entry entry;
+
+    while (!rest.empty())
+    {
+        auto const end{rest.find('\n')};
+        auto const line{rest.substr(0, end)};
+        rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 1);
+
+        if (parse_listing_line(line, a_mlsd, entry))
+        {
+            entries.push_back(entry);
+        }
+    }
+
+    return entries;
+}
+
+}   // namespace ftp
+}   // namespace rs
@@ -31,7 +31,7 @@ static auto log_level_to_str(log_level a_log_level) noexcept -> std::string
     }
 }
 
-auto logger::log(log_level a_log_level, std::string const& a_log_message) noexcept -> void
+auto logger::log(log_level a_log_level, std::string_view a_log_message) noexcept -> void
 {
     std::cout << log_level_to_str(a_log_level)
               << ": "
@@ -50,7 +50,7 @@ auto logger::set_log_level(log_level a_log_level) noexcept -> void
     logger.m_log_level = a_log_level;
 }
 
-auto logger::debug(std::string const& a_log_message) noexcept -> void
+auto logger::debug(std::string_view a_log_message) noexcept -> void
 {
 #ifndef NDEBUG
     logger& logger = logger::instance();
@@ -61,7 +61,7 @@ auto logger::debug(std::string const& a_log_message) noexcept -> void
 #endif
 }
 
-auto logger::info(std::string const& a_log_message) noexcept -> void
+auto logger::info(std::string_view a_log_message) noexcept -> void
 {
     logger& logger = logger::instance();
     if (logger.should_log(log_level::INFO))
@@ -70,7 +70,7 @@ auto logger::info(std::string const& a_log_message) noexcept -> void
     }
 }
 
-auto logger::warning(std::string const& a_log_message) noexcept -> void
+auto logger::warning(std::string_view a_log_message) noexcept -> void
 {
     logger& logger = logger::instance();
     if (logger.should_log(log_level::WARNING))
@@ -79,7 +79,7 @@ auto logger::warning(std::string const& a_log_message) noexcept -> void
     }
 }
 
-auto logger::error(std::string const& a_log_message) noexcept -> void
+auto logger::error(std::string_view a_log_message) noexcept -> void
 {
     logger& logger = logger::instance();
     if (logger.should_log(log_level::ERROR))
@@ -88,7 +88,7 @@ auto logger::error(std::string const& a_log_message) noexcept -> void
     }
 }
 
-auto logger::critical(std::string const& a_log_message) noexcept -> void
+auto logger::critical(std::string_view a_log_message) noexcept -> void
 {
     logger& logger = logger::instance();
     if (logger.should_log(log_level::CRITICAL))
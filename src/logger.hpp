@@ -4,6 +4,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 
 namespace rs
@@ -31,16 +32,16 @@ public:
 
     static auto set_log_level(log_level a_log_level) noexcept -> void;
 
-    static auto debug(std::string const& a_log_message) noexcept -> void;
-    static auto info(std::string const& a_log_message) noexcept -> void;
-    static auto warning(std::string const& a_log_message) noexcept -> void;
-    static auto error(std::string const& a_log_message) noexcept -> void;
-    static auto critical(std::string const& a_log_message) noexcept -> void;
+    static auto debug(std::string_view a_log_message) noexcept -> void;
+    static auto info(std::string_view a_log_message) noexcept -> void;
+    static auto warning(std::string_view a_log_message) noexcept -> void;
+    static auto error(std::string_view a_log_message) noexcept -> void;
+    static auto critical(std::string_view a_log_message) noexcept -> void;
 
 private:
     logger();
 
-    auto log(log_level a_log_level, std::string const& a_log_message) noexcept -> void;
+    auto log(log_level a_log_level, std::string_view a_log_message) noexcept -> void;
     auto should_log(log_level a_log_level) const noexcept -> bool;
 
     static auto instance() noexcept -> logger&;
@@ -0,0 +1,956 @@
+#include <ftp/session_pool.hpp>
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <cassert>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/system_error.hpp>
+
+#include "util.hpp"
+#include "logger.hpp"
+
+
+namespace rs
+{
+namespace ftp
+{
+
+// NOTE - Ranges of a parallel transfer - (count, length), the last range may be shorter. Rounding
+//        the length up can leave fewer ranges than requested, 10 bytes in 7 ranges are 5 ranges of
+//        2 bytes, so the count follows from the length and no range starts past the end.
+static auto split_segments(
+    std::size_t a_size,
+    std::size_t a_segments
+)
+noexcept -> std::pair<std::size_t, std::size_t>
+{
+    auto const requested{std::max<std::size_t>(1, std::min(a_segments, a_size))};
+    auto const segment_length{std::max<std::size_t>(1, (a_size + requested - 1) / requested)};
+
+    auto const segments{(a_size + segment_length - 1) / segment_length};
+
+    return {std::max<std::size_t>(1, segments), segment_length};
+}
+
+// NOTE - Completion of a_count ranges - a_handler gets the first error once every range is done,
+//        so no range is still running when it is called.
+static auto join_ranges(
+    std::size_t a_count,
+    std::function<void(std::exception_ptr)> a_handler
+)
+-> std::function<void(std::exception_ptr)>
+{
+    auto pending{std::make_shared<std::size_t>(a_count)};
+    auto first_error{std::make_shared<std::exception_ptr>()};
+
+    return [pending, first_error, a_handler](std::exception_ptr a_error) -> void
+    {
+        if (a_error && !*first_error)
+        {
+            *first_error = a_error;
+        }
+
+        if (--*pending == 0)
+        {
+            a_handler(*first_error);
+        }
+    };
+}
+
+struct session_pool::impl : public std::enable_shared_from_this<session_pool::impl>
+{
+    using acquire_handler = std::function<void(std::exception_ptr, session)>;
+
+    struct idle_session
+    {
+        std::shared_ptr<client> m_client;
+        std::chrono::steady_clock::time_point m_idle_since;
+    };
+
+    struct endpoint
+    {
+        connection_options m_options;
+        std::deque<idle_session> m_idle;
+        std::deque<acquire_handler> m_waiters;
+        // NOTE - Connected sessions - idle, checked out, being opened or being pinged.
+        std::size_t m_size{0};
+        // NOTE - Spares being opened in the background, acquire() waits for them.
+        std::size_t m_spares{0};
+        // NOTE - Keepalive NOOPs the server answered.
+        std::size_t m_keepalives{0};
+    };
+
+    boost::asio::io_context& m_io_context;
+    boost::asio::steady_timer m_keepalive_timer;
+    std::size_t m_sessions_per_endpoint;
+    std::chrono::milliseconds m_keepalive_interval;
+    std::map<std::string, endpoint> m_endpoints;
+    bool m_keepalive_armed;
+    bool m_closed;
+
+    impl(
+        boost::asio::io_context& a_io_context,
+        std::size_t a_sessions_per_endpoint,
+        std::chrono::milliseconds a_keepalive_interval
+    ) :
+        m_io_context(a_io_context),
+        m_keepalive_timer(m_io_context),
+        m_sessions_per_endpoint(a_sessions_per_endpoint),
+        m_keepalive_interval(a_keepalive_interval),
+        m_keepalive_armed(false),
+        m_closed(false)
+    { }
+
+    static auto make_key(connection_options const& a_opts) -> std::string
+    {
+        // NOTE - CRLF can not be part of a hostname or of a USER argument.
+        return a_opts.server_hostname + CRLF + std::to_string(a_opts.server_port) + CRLF +
+               a_opts.username;
+    }
+
+    auto deliver(
+        acquire_handler a_handler,
+        std::exception_ptr a_error,
+        session a_session
+    )
+    -> void
+    {
+        boost::asio::post(
+            m_io_context,
+            [a_handler = std::move(a_handler), a_error, s = std::move(a_session)]() mutable -> void
+            {
+                a_handler(a_error, std::move(s));
+            }
+        );
+    }
+
+    auto acquire(
+        connection_options const& a_opts,
+        acquire_handler a_handler
+    )
+    -> void
+    {
+        if (m_closed)
+        {
+            deliver(std::move(a_handler), aborted_error(), session());
+            return;
+        }
+
+        auto key{make_key(a_opts)};
+        auto& ep{m_endpoints[key]};
+        ep.m_options = a_opts;
+
+        // NOTE - Most recently used first, the oldest idle sessions are left to the keepalive.
+        while (!ep.m_idle.empty())
+        {
+            auto idle{std::move(ep.m_idle.back())};
+            ep.m_idle.pop_back();
+
+            if (idle.m_client->is_open())
+            {
+                deliver(std::move(a_handler), nullptr, session(shared_from_this(), key,
+                                                               std::move(idle.m_client)));
+                return;
+            }
+
+            --ep.m_size;
+        }
+
+        if (ep.m_spares == 0 && ep.m_size < m_sessions_per_endpoint)
+        {
+            ++ep.m_size;
+            open(key, std::move(a_handler));
+            return;
+        }
+
+        ep.m_waiters.push_back(std::move(a_handler));
+    }
+
+    auto open(
+        std::string const& a_key,
+        acquire_handler a_handler
+    )
+    -> void
+    {
+        auto self{shared_from_this()};
+        auto c{std::make_shared<client>(m_io_context, m_endpoints[a_key].m_options)};
+
+        c->async_connect([self, a_key, c, a_handler](std::exception_ptr a_error) -> void
+        {
+            if (a_error)
+            {
+                self->open_failed(a_key, a_error, a_handler);
+                return;
+            }
+
+            c->async_login([self, a_key, c, a_handler](std::exception_ptr a_error) -> void
+            {
+                if (a_error)
+                {
+                    self->open_failed(a_key, a_error, a_handler);
+                    return;
+                }
+
+                if (self->m_closed)
+                {
+                    a_handler(aborted_error(), session());
+                    return;
+                }
+
+                a_handler(nullptr, session(self, a_key, c));
+            });
+        });
+    }
+
+    auto open_failed(
+        std::string const& a_key,
+        std::exception_ptr a_error,
+        acquire_handler const& a_handler
+    )
+    -> void
+    {
+        auto& ep{m_endpoints[a_key]};
+        --ep.m_size;
+
+        a_handler(a_error, session());
+
+        // NOTE - Each waiter gets its own attempt, so none of them is left waiting forever. No
+        //        spare is opened, an unreachable server is not retried in a loop.
+        replace(a_key, false);
+    }
+
+    // NOTE - Opens a session for the next waiter, or a spare one when nobody is waiting.
+    auto replace(
+        std::string const& a_key,
+        bool a_spare
+    )
+    -> void
+    {
+        auto& ep{m_endpoints[a_key]};
+
+        if (m_closed || ep.m_size >= m_sessions_per_endpoint)
+        {
+            return;
+        }
+
+        if (!ep.m_waiters.empty())
+        {
+            auto waiter{std::move(ep.m_waiters.front())};
+            ep.m_waiters.pop_front();
+            ++ep.m_size;
+            open(a_key, std::move(waiter));
+        } else if (a_spare)
+        {
+            ++ep.m_size;
+            ++ep.m_spares;
+            open(a_key, [self = shared_from_this(), a_key](std::exception_ptr a_error, session)
+            -> void
+            {
+                --self->m_endpoints[a_key].m_spares;
+
+                if (a_error)
+                {
+                    try
+                    {
+                        std::rethrow_exception(a_error);
+                    } catch (std::exception const& e)
+                    {
+                        logger::warning(std::string("Failed to replace session: ") + e.what());
+                    }
+                }
+            });
+        }
+    }
+
+    auto release(
+        std::string const& a_key,
+        std::shared_ptr<client> a_client
+    )
+    noexcept -> void
+    {
+        if (m_closed)
+        {
+            return;
+        }
+
+        try
+        {
+            auto& ep{m_endpoints[a_key]};
+
+            if (!a_client->is_open())
+            {
+                --ep.m_size;
+                replace(a_key, true);
+                return;
+            }
+
+            if (!ep.m_waiters.empty())
+            {
+                auto waiter{std::move(ep.m_waiters.front())};
+                ep.m_waiters.pop_front();
+                deliver(std::move(waiter), nullptr, session(shared_from_this(), a_key,
+                                                            std::move(a_client)));
+                return;
+            }
+
+            ep.m_idle.push_back({std::move(a_client), std::chrono::steady_clock::now()});
+            arm_keepalive();
+        } catch (std::exception const& e)
+        {
+            logger::error(e.what());
+        }
+    }
+
+    auto arm_keepalive() -> void
+    {
+        if (m_keepalive_armed)
+        {
+            return;
+        }
+
+        // NOTE - Idle sessions are appended, so the front of every deque is the oldest.
+        auto next{std::chrono::steady_clock::time_point::max()};
+        for (auto const& [key, ep] : m_endpoints)
+        {
+            if (!ep.m_idle.empty())
+            {
+                next = std::min(next, ep.m_idle.front().m_idle_since + m_keepalive_interval);
+            }
+        }
+
+        if (next == std::chrono::steady_clock::time_point::max())
+        {
+            return;
+        }
+
+        m_keepalive_armed = true;
+        m_keepalive_timer.expires_at(next);
+        m_keepalive_timer.async_wait([self = shared_from_this()](
+            boost::system::error_code const& a_ec
+        ) -> void
+        {
+            self->m_keepalive_armed = false;
+
+            if (a_ec || self->m_closed)
+            {
+                return;
+            }
+
+            self->keepalive();
+            self->arm_keepalive();
+        });
+    }
+
+    auto keepalive() -> void
+    {
+        auto const now{std::chrono::steady_clock::now()};
+
+        for (auto& [key, ep] : m_endpoints)
+        {
+            while (!ep.m_idle.empty() &&
+                   ep.m_idle.front().m_idle_since + m_keepalive_interval <= now)
+            {
+                auto c{std::move(ep.m_idle.front().m_client)};
+                ep.m_idle.pop_front();
+
+                c->async_noop([self = shared_from_this(), key = key, c](std::exception_ptr a_error)
+                -> void
+                {
+                    if (a_error)
+                    {
+                        if (!self->m_closed)
+                        {
+                            --self->m_endpoints[key].m_size;
+                            self->replace(key, true);
+                        }
+                        return;
+                    }
+
+                    ++self->m_endpoints[key].m_keepalives;
+                    self->release(key, c);
+                });
+            }
+        }
+    }
+
+    auto download_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::size_t a_segments,
+        std::function<void(std::size_t)> a_size_callback,
+        std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+        std::function<void(std::exception_ptr)> a_handler
+    )
+    -> void
+    {
+        auto self{shared_from_this()};
+
+        acquire(a_opts, [=](std::exception_ptr a_error, session a_session) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            auto first{std::make_shared<session>(std::move(a_session))};
+
+            (*first)->async_size(a_filename, [=](std::exception_ptr a_error, std::size_t a_size)
+            -> void
+            {
+                if (a_error)
+                {
+                    a_handler(a_error);
+                    return;
+                }
+
+                try
+                {
+                    a_size_callback(a_size);
+                } catch (...)
+                {
+                    a_handler(std::current_exception());
+                    return;
+                }
+
+                auto const split{split_segments(a_size, a_segments)};
+                auto const segments{split.first};
+                auto const segment_length{split.second};
+
+                // NOTE - No range writes to the sink after the handler ran.
+                auto const done{join_ranges(segments, a_handler)};
+
+                for (std::size_t i = 0; i < segments; ++i)
+                {
+                    auto const offset{i * segment_length};
+                    auto const length{std::min(segment_length, a_size - offset)};
+
+                    if (i == 0)
+                    {
+                        self->download_range(first, a_filename, offset, length, a_data_callback,
+                                             done);
+                        continue;
+                    }
+
+                    self->acquire(a_opts, [=](std::exception_ptr a_error, session a_session)
+                    -> void
+                    {
+                        if (a_error)
+                        {
+                            done(a_error);
+                            return;
+                        }
+
+                        self->download_range(std::make_shared<session>(std::move(a_session)),
+                                             a_filename, offset, length, a_data_callback, done);
+                    });
+                }
+            });
+        });
+    }
+
+    auto download_range(
+        std::shared_ptr<session> a_session,
+        std::string const& a_filename,
+        std::size_t a_offset,
+        std::size_t a_length,
+        std::function<void(std::size_t, char const*, std::size_t)> a_data_callback,
+        std::function<void(std::exception_ptr)> a_handler
+    )
+    -> void
+    {
+        (*a_session)->download_range(
+            a_filename,
+            a_offset,
+            a_length,
+            std::move(a_data_callback),
+            [a_session, a_handler](std::exception_ptr a_error) -> void
+            {
+                if (a_error)
+                {
+                    a_session->discard();
+                }
+
+                a_handler(a_error);
+            }
+        );
+    }
+
+    auto upload_parallel(
+        connection_options const& a_opts,
+        std::string const& a_filename,
+        std::string const& a_local_path,
+        std::size_t a_segments,
+        std::function<void(std::exception_ptr)> a_handler
+    )
+    -> void
+    {
+        std::size_t size{0};
+
+        try
+        {
+            size = local_file_size(a_local_path);
+        } catch (...)
+        {
+            boost::asio::post(m_io_context, [error = std::current_exception(), a_handler]() -> void
+            {
+                a_handler(error);
+            });
+            return;
+        }
+
+        auto self{shared_from_this()};
+
+        acquire(a_opts, [=](std::exception_ptr a_error, session a_session) -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            auto first{std::make_shared<session>(std::move(a_session))};
+            auto const split{split_segments(size, a_segments)};
+            auto const segments{split.first};
+            auto const segment_length{split.second};
+
+            // NOTE - REST being accepted does not mean STOR is accepted at an offset (ProFTPD
+            //        without AllowStoreRestart), so a ranged STOR the server refuses is not an
+            //        error - once every range is done the whole file goes again, as one stream.
+            auto rejected{std::make_shared<bool>(false)};
+            auto const done{join_ranges(
+                segments,
+                [=](std::exception_ptr a_error) -> void
+                {
+                    if (a_error || !*rejected)
+                    {
+                        a_handler(a_error);
+                        return;
+                    }
+
+                    self->acquire(a_opts, [=](std::exception_ptr a_error, session a_session)
+                    -> void
+                    {
+                        if (a_error)
+                        {
+                            a_handler(a_error);
+                            return;
+                        }
+
+                        self->upload_range(
+                            std::make_shared<session>(std::move(a_session)),
+                            a_filename,
+                            a_local_path,
+                            0,
+                            size,
+                            [](std::exception_ptr) -> void
+                            { },
+                            a_handler
+                        );
+                    });
+                }
+            )};
+
+            // NOTE - The other ranges must not reach the server before the first range truncated
+            //        the file.
+            auto started{std::make_shared<bool>(false)};
+            auto start_others = [=](std::exception_ptr a_error) -> void
+            {
+                if (*started)
+                {
+                    return;
+                }
+                *started = true;
+
+                for (std::size_t i = 1; i < segments; ++i)
+                {
+                    if (a_error)
+                    {
+                        done(a_error);
+                        continue;
+                    }
+
+                    auto const offset{i * segment_length};
+                    auto const length{std::min(segment_length, size - offset)};
+
+                    self->acquire(a_opts, [=](std::exception_ptr a_error, session a_session)
+                    -> void
+                    {
+                        if (a_error)
+                        {
+                            done(a_error);
+                            return;
+                        }
+
+                        auto accepted{std::make_shared<bool>(false)};
+
+                        self->upload_range(
+                            std::make_shared<session>(std::move(a_session)),
+                            a_filename,
+                            a_local_path,
+                            offset,
+                            length,
+                            [accepted](std::exception_ptr) -> void
+                            {
+                                *accepted = true;
+                            },
+                            [=](std::exception_ptr a_error) -> void
+                            {
+                                if (a_error && !*accepted && is_reply_error(a_error))
+                                {
+                                    *rejected = true;
+                                    done(nullptr);
+                                    return;
+                                }
+
+                                done(a_error);
+                            }
+                        );
+                    });
+                }
+            };
+
+            self->upload_range(
+                first,
+                a_filename,
+                a_local_path,
+                0,
+                segment_length,
+                start_others,
+                [start_others, done](std::exception_ptr a_error) -> void
+                {
+                    start_others(a_error);
+                    done(a_error);
+                }
+            );
+        });
+    }
+
+    auto upload_range(
+        std::shared_ptr<session> a_session,
+        std::string const& a_filename,
+        std::string const& a_local_path,
+        std::size_t a_offset,
+        std::size_t a_length,
+        std::function<void(std::exception_ptr)> a_started_handler,
+        std::function<void(std::exception_ptr)> a_handler
+    )
+    -> void
+    {
+        auto ifs{std::make_shared<std::ifstream>(a_local_path, std::ios::binary)};
+        ifs->seekg(a_offset);
+
+        if (!*ifs)
+        {
+            a_handler(std::make_exception_ptr(
+                std::runtime_error("Failed to read " + a_local_path)
+            ));
+            return;
+        }
+
+        (*a_session)->upload_range(
+            a_filename,
+            *ifs,
+            a_offset,
+            a_length,
+            std::move(a_started_handler),
+            [a_session, ifs, a_handler](std::exception_ptr a_error) -> void
+            {
+                if (a_error)
+                {
+                    a_session->discard();
+                }
+
+                a_handler(a_error);
+            }
+        );
+    }
+
+    auto shutdown() noexcept -> void
+    {
+        m_closed = true;
+        m_keepalive_timer.cancel();
+
+        for (auto& [key, ep] : m_endpoints)
+        {
+            ep.m_idle.clear();
+
+            for (auto& waiter : ep.m_waiters)
+            {
+                deliver(std::move(waiter), aborted_error(), session());
+            }
+            ep.m_waiters.clear();
+        }
+    }
+
+    static auto aborted_error() -> std::exception_ptr
+    {
+        return std::make_exception_ptr(boost::system::system_error(
+            boost::asio::error::operation_aborted,
+            "Session pool closed"
+        ));
+    }
+};
+
+session_pool::session::session(
+    std::shared_ptr<session_pool::impl> a_pool,
+    std::string a_key,
+    std::shared_ptr<client> a_client
+) :
+    m_pool(std::move(a_pool)),
+    m_key(std::move(a_key)),
+    m_client(std::move(a_client))
+{ }
+
+session_pool::session::~session() noexcept
+{
+    release();
+}
+
+auto session_pool::session::operator=(session&& a_other) noexcept
+-> session&
+{
+    if (this != &a_other)
+    {
+        release();
+        m_pool = std::move(a_other.m_pool);
+        m_key = std::move(a_other.m_key);
+        m_client = std::move(a_other.m_client);
+    }
+
+    return *this;
+}
+
+auto session_pool::session::operator*() const noexcept
+-> client&
+{
+    assert(m_client && "empty session");
+    return *m_client;
+}
+
+auto session_pool::session::operator->() const noexcept
+-> client*
+{
+    assert(m_client && "empty session");
+    return m_client.get();
+}
+
+session_pool::session::operator bool() const noexcept
+{
+    return static_cast<bool>(m_client);
+}
+
+auto session_pool::session::release() noexcept
+-> void
+{
+    if (m_pool && m_client)
+    {
+        m_pool->release(m_key, std::move(m_client));
+    }
+
+    m_pool.reset();
+    m_client.reset();
+}
+
+auto session_pool::session::discard() noexcept
+-> void
+{
+    if (m_client)
+    {
+        m_client->m_control_connection.abort();
+    }
+
+    release();
+}
+
+session_pool::session_pool(
+    boost::asio::io_context& a_io_context,
+    std::size_t a_sessions_per_endpoint,
+    std::chrono::milliseconds a_keepalive_interval
+) :
+    m_io_context(a_io_context),
+    m_impl(std::make_shared<impl>(a_io_context, a_sessions_per_endpoint, a_keepalive_interval))
+{
+    assert(a_sessions_per_endpoint > 0 && "empty session pool");
+}
+
+session_pool::~session_pool() noexcept
+{
+    m_impl->shutdown();
+}
+
+auto session_pool::acquire(connection_options const& a_opts)
+-> session
+{
+    return run_blocking<session>(
+        m_io_context,
+        [&, this](std::function<void(std::exception_ptr, session)> a_handler) -> void
+        {
+            start_acquire(a_opts, std::move(a_handler));
+        }
+    );
+}
+
+auto session_pool::get_io_context() noexcept
+-> boost::asio::io_context&
+{
+    return m_io_context;
+}
+
+auto session_pool::size(connection_options const& a_opts) const
+-> std::size_t
+{
+    auto it{m_impl->m_endpoints.find(impl::make_key(a_opts))};
+
+    return it == m_impl->m_endpoints.end() ? 0 : it->second.m_size;
+}
+
+auto session_pool::keepalives(connection_options const& a_opts) const
+-> std::size_t
+{
+    auto it{m_impl->m_endpoints.find(impl::make_key(a_opts))};
+
+    return it == m_impl->m_endpoints.end() ? 0 : it->second.m_keepalives;
+}
+
+auto session_pool::start_acquire(
+    connection_options const& a_opts,
+    std::function<void(std::exception_ptr, session)> a_handler
+)
+-> void
+{
+    m_impl->acquire(a_opts, std::move(a_handler));
+}
+
+auto session_pool::download_parallel(
+    connection_options const& a_opts,
+    std::string const& a_filename,
+    std::size_t a_segments
+)
+-> std::vector<char>
+{
+    return run_blocking<std::vector<char>>(
+        m_io_context,
+        [&, this](std::function<void(std::exception_ptr, std::vector<char>)> a_handler) -> void
+        {
+            start_download_parallel(a_opts, a_filename, a_segments, std::move(a_handler));
+        }
+    );
+}
+
+auto session_pool::download_parallel(
+    connection_options const& a_opts,
+    std::string const& a_filename,
+    std::ofstream& a_ofstream,
+    std::size_t a_segments
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](std::function<void(std::exception_ptr)> a_handler) -> void
+    {
+        start_download_parallel(a_opts, a_filename, a_ofstream, a_segments, std::move(a_handler));
+    });
+}
+
+auto session_pool::start_download_parallel(
+    connection_options const& a_opts,
+    std::string const& a_filename,
+    std::size_t a_segments,
+    std::function<void(std::exception_ptr, std::vector<char>)> a_handler
+)
+-> void
+{
+    auto data{std::make_shared<std::vector<char>>()};
+
+    m_impl->download_parallel(
+        a_opts,
+        a_filename,
+        a_segments,
+        [data](std::size_t a_size) -> void
+        {
+            data->resize(a_size);
+        },
+        [data](std::size_t a_offset, char const* a_data, std::size_t a_size) -> void
+        {
+            if (a_offset + a_size > data->size())
+            {
+                throw std::length_error("Server sent more data than the reported file size");
+            }
+
+            std::copy(a_data, a_data + a_size, data->begin() + a_offset);
+        },
+        [data, a_handler](std::exception_ptr a_error) -> void
+        {
+            a_handler(a_error, a_error ? std::vector<char>{} : std::move(*data));
+        }
+    );
+}
+
+auto session_pool::start_download_parallel(
+    connection_options const& a_opts,
+    std::string const& a_filename,
+    std::ofstream& a_ofstream,
+    std::size_t a_segments,
+    std::function<void(std::exception_ptr)> a_handler
+)
+-> void
+{
+    m_impl->download_parallel(
+        a_opts,
+        a_filename,
+        a_segments,
+        []([[ maybe_unused ]] std::size_t a_size) -> void
+        { },
+        [&a_ofstream](std::size_t a_offset, char const* a_data, std::size_t a_size) -> void
+        {
+            a_ofstream.seekp(a_offset);
+            a_ofstream.write(a_data, a_size);
+
+            if (!a_ofstream)
+            {
+                throw std::runtime_error(
+                    "Failed to write " + std::to_string(a_size) + " bytes at offset " +
+                    std::to_string(a_offset)
+                );
+            }
+        },
+        std::move(a_handler)
+    );
+}
+
+auto session_pool::upload_parallel(
+    connection_options const& a_opts,
+    std::string const& a_filename,
+    std::string const& a_local_path,
+    std::size_t a_segments
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](std::function<void(std::exception_ptr)> a_handler) -> void
+    {
+        start_upload_parallel(a_opts, a_filename, a_local_path, a_segments, std::move(a_handler));
+    });
+}
+
+auto session_pool::start_upload_parallel(
+    connection_options const& a_opts,
+    std::string const& a_filename,
+    std::string const& a_local_path,
+    std::size_t a_segments,
+    std::function<void(std::exception_ptr)> a_handler
+)
+-> void
+{
+    m_impl->upload_parallel(a_opts, a_filename, a_local_path, a_segments, std::move(a_handler));
+}
+
+}   // namespace ftp
+}   // namespace rs
@@ -0,0 +1,675 @@
+#include <ftp/transfer_engine.hpp>
+
+#include <deque>
+#include <cassert>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+#include <boost/asio/post.hpp>
+
+#include "util.hpp"
+#include "logger.hpp"
+#include "commands.hpp"
+
+
+namespace rs
+{
+namespace ftp
+{
+
+struct transfer_engine::impl : public std::enable_shared_from_this<transfer_engine::impl>
+{
+    using completion_handler = std::function<void(std::exception_ptr)>;
+
+    session_pool& m_pool;
+    connection_options m_options;
+    std::size_t m_concurrency;
+    std::size_t m_max_in_flight_bytes;
+    std::deque<transfer_job> m_jobs;
+    // NOTE - Remote directories of a mirror_down waiting to be listed - (remote, local).
+    std::deque<std::pair<std::string, std::string>> m_listings;
+    // NOTE - Jobs waiting for the in flight bytes to drop, in the order they asked.
+    std::deque<std::pair<std::size_t, std::function<void()>>> m_budget_waiters;
+    std::vector<transfer_error::job_error> m_errors;
+    std::size_t m_running;
+    std::size_t m_in_flight_bytes;
+    completion_handler m_handler;
+
+    impl(
+        session_pool& a_pool,
+        connection_options const& a_opts,
+        std::size_t a_concurrency,
+        std::size_t a_max_in_flight_bytes
+    ) :
+        m_pool(a_pool),
+        m_options(a_opts),
+        m_concurrency(a_concurrency),
+        m_max_in_flight_bytes(a_max_in_flight_bytes),
+        m_running(0),
+        m_in_flight_bytes(0)
+    { }
+
+    auto run(completion_handler a_handler) -> void
+    {
+        assert(!m_handler && "transfer_engine is already running");
+
+        m_handler = std::move(a_handler);
+        m_errors.clear();
+        pump();
+    }
+
+    auto pump() -> void
+    {
+        // NOTE - Listings first, so the walk of a mirror widens and keeps every session busy.
+        while (m_running < m_concurrency && !m_listings.empty())
+        {
+            auto listing{std::move(m_listings.front())};
+            m_listings.pop_front();
+            ++m_running;
+            list(std::move(listing.first), std::move(listing.second));
+        }
+
+        while (m_running < m_concurrency && !m_jobs.empty())
+        {
+            auto job{std::make_shared<transfer_job>(std::move(m_jobs.front()))};
+            m_jobs.pop_front();
+            ++m_running;
+            start(job);
+        }
+
+        if (m_running == 0 && m_jobs.empty() && m_listings.empty() && m_handler)
+        {
+            auto handler{std::move(m_handler)};
+            m_handler = nullptr;
+
+            std::exception_ptr error;
+            if (!m_errors.empty())
+            {
+                error = std::make_exception_ptr(transfer_error(std::move(m_errors)));
+                m_errors.clear();
+            }
+
+            boost::asio::post(m_pool.get_io_context(), [handler, error]() -> void
+            {
+                handler(error);
+            });
+        }
+    }
+
+    auto start(std::shared_ptr<transfer_job> a_job) -> void
+    {
+        auto self{shared_from_this()};
+
+        // NOTE - A job waits for the budget before it takes a session. Parked on a session, it
+        //        would get no keepalive from the pool and could be dropped by the server.
+        if (a_job->type == transfer_job::direction::UPLOAD)
+        {
+            std::size_t size{0};
+
+            try
+            {
+                size = local_file_size(a_job->local_path);
+            } catch (...)
+            {
+                finish(a_job, 0, std::current_exception());
+                return;
+            }
+
+            reserve(size, [self, a_job, size]() -> void
+            {
+                self->transfer(a_job, size);
+            });
+            return;
+        }
+
+        if (a_job->size)
+        {
+            reserve(*a_job->size, [self, a_job, size = *a_job->size]() -> void
+            {
+                self->transfer(a_job, size);
+            });
+            return;
+        }
+
+        m_pool.async_acquire(m_options, [self, a_job](
+            std::exception_ptr a_error,
+            session_pool::session a_session
+        ) -> void
+        {
+            if (a_error)
+            {
+                self->finish(a_job, 0, a_error);
+                return;
+            }
+
+            auto s{std::make_shared<session_pool::session>(std::move(a_session))};
+
+            // NOTE - Servers without SIZE still get the download, it is just not budgeted.
+            (*s)->async_size(a_job->remote_path, [self, a_job, s](
+                std::exception_ptr a_error,
+                std::size_t a_size
+            ) -> void
+            {
+                auto const size{a_error ? 0 : a_size};
+
+                if (a_error && !(*s)->is_open())
+                {
+                    self->finish(a_job, 0, a_error);
+                    return;
+                }
+
+                if (self->try_reserve(size))
+                {
+                    self->download(a_job, s, size);
+                    return;
+                }
+
+                // NOTE - The session goes back to the pool for the wait, one is taken again once
+                //        the job fits.
+                s->release();
+                self->m_budget_waiters.emplace_back(size, [self, a_job, size]() -> void
+                {
+                    self->transfer(a_job, size);
+                });
+            });
+        });
+    }
+
+    // NOTE - Runs a job whose size is already reserved.
+    auto transfer(
+        std::shared_ptr<transfer_job> a_job,
+        std::size_t a_size
+    )
+    -> void
+    {
+        m_pool.async_acquire(m_options, [self = shared_from_this(), a_job, a_size](
+            std::exception_ptr a_error,
+            session_pool::session a_session
+        ) -> void
+        {
+            if (a_error)
+            {
+                self->finish(a_job, a_size, a_error);
+                return;
+            }
+
+            auto s{std::make_shared<session_pool::session>(std::move(a_session))};
+
+            if (a_job->type == transfer_job::direction::UPLOAD)
+            {
+                self->upload(a_job, s, a_size);
+            } else
+            {
+                self->download(a_job, s, a_size);
+            }
+        });
+    }
+
+    auto list(
+        std::string a_remote_dir,
+        std::string a_local_dir
+    )
+    -> void
+    {
+        auto self{shared_from_this()};
+        // NOTE - Describes the directory in the transfer_error if the listing fails.
+        auto job{std::make_shared<transfer_job>()};
+        job->type = transfer_job::direction::DOWNLOAD;
+        job->remote_path = std::move(a_remote_dir);
+        job->local_path = std::move(a_local_dir);
+
+        m_pool.async_acquire(m_options, [self, job](
+            std::exception_ptr a_error,
+            session_pool::session a_session
+        ) -> void
+        {
+            if (a_error)
+            {
+                self->finish(job, 0, a_error);
+                return;
+            }
+
+            auto s{std::make_shared<session_pool::session>(std::move(a_session))};
+
+            (*s)->async_list_directory(job->remote_path, [self, job, s](
+                std::exception_ptr a_error,
+                directory_listing a_listing
+            ) -> void
+            {
+                if (a_error)
+                {
+                    s->discard();
+                    self->finish(job, 0, a_error);
+                    return;
+                }
+
+                s->release();
+
+                try
+                {
+                    self->queue_listing(*job, a_listing);
+                } catch (...)
+                {
+                    a_error = std::current_exception();
+                }
+
+                self->finish(job, 0, a_error);
+            });
+        });
+    }
+
+    auto queue_listing(
+        transfer_job const& a_directory,
+        directory_listing const& a_listing
+    )
+    -> void
+    {
+        for (auto const& entry : a_listing)
+        {
+            if (entry.type != entry_type::DIRECTORY && entry.type != entry_type::FILE)
+            {
+                continue;
+            }
+
+            std::string const name{entry.name};
+            auto const remote{join_remote_path(a_directory.remote_path, name)};
+
+            // NOTE - The names come from the server - "../x" or "/etc/x" must not take the mirror
+            //        outside of its local directory.
+            auto const directory{std::filesystem::path(a_directory.local_path).lexically_normal()};
+            auto const local{(directory / name).lexically_normal()};
+
+            if (!is_safe_entry_name(name) || local.lexically_relative(directory) != name)
+            {
+                transfer_job rejected;
+                rejected.type = transfer_job::direction::DOWNLOAD;
+                rejected.remote_path = remote;
+                m_errors.emplace_back(rejected, std::make_exception_ptr(std::runtime_error(
+                    "Unsafe name in the listing of " + a_directory.remote_path + ": " + name
+                )));
+                continue;
+            }
+
+            if (entry.type == entry_type::DIRECTORY)
+            {
+                std::filesystem::create_directories(local);
+                m_listings.emplace_back(remote, local.string());
+            } else
+            {
+                transfer_job job;
+                job.type = transfer_job::direction::DOWNLOAD;
+                job.remote_path = remote;
+                job.local_path = local.string();
+                // NOTE - Saves a SIZE round trip per file.
+                if (entry.size)
+                {
+                    job.size = static_cast<std::size_t>(*entry.size);
+                }
+                m_jobs.push_back(std::move(job));
+            }
+        }
+    }
+
+    static auto join_remote_path(
+        std::string const& a_directory,
+        std::string const& a_name
+    )
+    -> std::string
+    {
+        if (a_directory.empty())
+        {
+            return a_name;
+        }
+
+        return a_directory.back() == '/' ? a_directory + a_name : a_directory + '/' + a_name;
+    }
+
+    auto reserve(
+        std::size_t a_size,
+        std::function<void()> a_continuation
+    )
+    -> void
+    {
+        if (try_reserve(a_size))
+        {
+            a_continuation();
+            return;
+        }
+
+        m_budget_waiters.emplace_back(a_size, std::move(a_continuation));
+    }
+
+    // NOTE - First come, first served - a small job does not run ahead of a waiting large one,
+    //        which would otherwise wait for the whole queue to drain.
+    auto try_reserve(std::size_t a_size) -> bool
+    {
+        if (!m_budget_waiters.empty() || !fits(a_size))
+        {
+            return false;
+        }
+
+        m_in_flight_bytes += a_size;
+        return true;
+    }
+
+    auto fits(std::size_t a_size) const -> bool
+    {
+        return m_in_flight_bytes == 0 || m_in_flight_bytes + a_size <= m_max_in_flight_bytes;
+    }
+
+    auto download(
+        std::shared_ptr<transfer_job> a_job,
+        std::shared_ptr<session_pool::session> a_session,
+        std::size_t a_size
+    )
+    -> void
+    {
+        // NOTE - The file only gets its name once it is complete, a failed or interrupted
+        //        download does not pass for a finished one on the next mirror.
+        auto partial_path{a_job->local_path + ".part"};
+        auto ofs{std::make_shared<std::ofstream>(partial_path, std::ios::binary)};
+
+        if (!*ofs)
+        {
+            finish(a_job, a_size, std::make_exception_ptr(
+                std::runtime_error("Failed to open " + partial_path)
+            ));
+            return;
+        }
+
+        (*a_session)->async_download(
+            a_job->remote_path,
+            *ofs,
+            [self = shared_from_this(), a_job, a_session, ofs, partial_path, a_size](
+                std::exception_ptr a_error
+            ) -> void
+            {
+                if (a_error)
+                {
+                    a_session->discard();
+                }
+
+                ofs->close();
+                std::error_code ec;
+
+                if (!a_error && !*ofs)
+                {
+                    a_error = std::make_exception_ptr(
+                        std::runtime_error("Failed to write " + partial_path)
+                    );
+                }
+
+                if (!a_error)
+                {
+                    std::filesystem::rename(partial_path, a_job->local_path, ec);
+
+                    if (ec)
+                    {
+                        a_error = std::make_exception_ptr(std::filesystem::filesystem_error(
+                            "Failed to rename",
+                            partial_path,
+                            a_job->local_path,
+                            ec
+                        ));
+                    }
+                }
+
+                if (a_error)
+                {
+                    std::filesystem::remove(partial_path, ec);
+                }
+
+                self->finish(a_job, a_size, a_error);
+            }
+        );
+    }
+
+    auto upload(
+        std::shared_ptr<transfer_job> a_job,
+        std::shared_ptr<session_pool::session> a_session,
+        std::size_t a_size
+    )
+    -> void
+    {
+        auto ifs{std::make_shared<std::ifstream>(a_job->local_path, std::ios::binary)};
+
+        if (!*ifs)
+        {
+            finish(a_job, a_size, std::make_exception_ptr(
+                std::runtime_error("Failed to open " + a_job->local_path)
+            ));
+            return;
+        }
+
+        (*a_session)->async_upload(
+            a_job->remote_path,
+            *ifs,
+            [self = shared_from_this(), a_job, a_session, ifs, a_size](std::exception_ptr a_error)
+            -> void
+            {
+                if (a_error)
+                {
+                    a_session->discard();
+                }
+
+                self->finish(a_job, a_size, a_error);
+            }
+        );
+    }
+
+    auto finish(
+        std::shared_ptr<transfer_job> a_job,
+        std::size_t a_size,
+        std::exception_ptr a_error
+    )
+    -> void
+    {
+        m_in_flight_bytes -= a_size;
+        --m_running;
+
+        if (a_error)
+        {
+            m_errors.emplace_back(*a_job, a_error);
+        }
+
+        if (a_job->on_complete)
+        {
+            try
+            {
+                a_job->on_complete(a_error);
+            } catch (std::exception const& e)
+            {
+                logger::error(e.what());
+            }
+        }
+
+        while (!m_budget_waiters.empty() && fits(m_budget_waiters.front().first))
+        {
+            auto waiter{std::move(m_budget_waiters.front())};
+            m_budget_waiters.pop_front();
+            m_in_flight_bytes += waiter.first;
+            waiter.second();
+        }
+
+        pump();
+    }
+};
+
+transfer_engine::transfer_engine(
+    session_pool& a_pool,
+    connection_options const& a_opts,
+    std::size_t a_concurrency,
+    std::size_t a_max_in_flight_bytes
+) :
+    m_io_context(a_pool.get_io_context()),
+    m_impl(std::make_shared<impl>(a_pool, a_opts, a_concurrency, a_max_in_flight_bytes))
+{
+    assert(a_concurrency > 0 && "no concurrency");
+}
+
+transfer_engine::~transfer_engine() noexcept =default;
+
+auto transfer_engine::add(transfer_job a_job)
+-> void
+{
+    m_impl->m_jobs.push_back(std::move(a_job));
+
+    if (m_impl->m_handler)
+    {
+        m_impl->pump();
+    }
+}
+
+auto transfer_engine::run()
+-> void
+{
+    run_blocking(m_io_context, [this](std::function<void(std::exception_ptr)> a_handler) -> void
+    {
+        start_run(std::move(a_handler));
+    });
+}
+
+auto transfer_engine::mirror_down(
+    std::string const& a_remote_dir,
+    std::string const& a_local_dir
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](std::function<void(std::exception_ptr)> a_handler) -> void
+    {
+        start_mirror_down(a_remote_dir, a_local_dir, std::move(a_handler));
+    });
+}
+
+auto transfer_engine::mirror_up(
+    std::string const& a_local_dir,
+    std::string const& a_remote_dir
+)
+-> void
+{
+    run_blocking(m_io_context, [&, this](std::function<void(std::exception_ptr)> a_handler) -> void
+    {
+        start_mirror_up(a_local_dir, a_remote_dir, std::move(a_handler));
+    });
+}
+
+auto transfer_engine::start_run(std::function<void(std::exception_ptr)> a_handler)
+-> void
+{
+    m_impl->run(std::move(a_handler));
+}
+
+auto transfer_engine::start_mirror_down(
+    std::string const& a_remote_dir,
+    std::string const& a_local_dir,
+    std::function<void(std::exception_ptr)> a_handler
+)
+-> void
+{
+    try
+    {
+        std::filesystem::create_directories(a_local_dir);
+    } catch (...)
+    {
+        boost::asio::post(m_io_context, [error = std::current_exception(), a_handler]() -> void
+        {
+            a_handler(error);
+        });
+        return;
+    }
+
+    m_impl->m_listings.emplace_back(a_remote_dir, a_local_dir);
+    m_impl->run(std::move(a_handler));
+}
+
+auto transfer_engine::start_mirror_up(
+    std::string const& a_local_dir,
+    std::string const& a_remote_dir,
+    std::function<void(std::exception_ptr)> a_handler
+)
+-> void
+{
+    command_batch directories;
+    std::vector<transfer_job> jobs;
+
+    // NOTE - Parents are visited before their children, so the MKDs are in a valid order. Already
+    //        existing directories fail with 550, which is not an error for a mirror.
+    try
+    {
+        directories.mkdir(a_remote_dir);
+
+        for (auto const& entry : std::filesystem::recursive_directory_iterator(a_local_dir))
+        {
+            auto const remote{
+                impl::join_remote_path(
+                    a_remote_dir,
+                    std::filesystem::relative(entry.path(), a_local_dir).generic_string()
+                )
+            };
+
+            if (entry.is_directory())
+            {
+                directories.mkdir(remote);
+            } else if (entry.is_regular_file())
+            {
+                transfer_job job;
+                job.type = transfer_job::direction::UPLOAD;
+                job.remote_path = remote;
+                job.local_path = entry.path().string();
+                jobs.push_back(std::move(job));
+            }
+        }
+    } catch (...)
+    {
+        boost::asio::post(m_io_context, [error = std::current_exception(), a_handler]() -> void
+        {
+            a_handler(error);
+        });
+        return;
+    }
+
+    auto self{m_impl};
+
+    m_impl->m_pool.async_acquire(
+        m_impl->m_options,
+        [self, directories, jobs = std::move(jobs), a_handler](
+            std::exception_ptr a_error,
+            session_pool::session a_session
+        ) mutable -> void
+        {
+            if (a_error)
+            {
+                a_handler(a_error);
+                return;
+            }
+
+            auto s{std::make_shared<session_pool::session>(std::move(a_session))};
+
+            (*s)->async_execute(directories, [self, s, jobs = std::move(jobs), a_handler](
+                std::exception_ptr a_error,
+                [[ maybe_unused ]] std::vector<command_reply> a_replies
+            ) mutable -> void
+            {
+                if (a_error)
+                {
+                    s->discard();
+                    a_handler(a_error);
+                    return;
+                }
+
+                s->release();
+
+                for (auto& job : jobs)
+                {
+                    self->m_jobs.push_back(std::move(job));
+                }
+
+                self->run(a_handler);
+            });
+        }
+    );
+}
+
+}   // namespace ftp
+}   // namespace rs
@@ -3,14 +3,28 @@
  */
 #pragma once
 
-#include <regex>
+#include <array>
 #include <tuple>
 #include <string>
 #include <vector>
-#include <sstream>
+#include <memory>
+#include <fstream>
 #include <cassert>
+#include <charconv>
+#include <optional>
 #include <exception>
+#include <stdexcept>
+#include <functional>
 #include <algorithm>
+#include <string_view>
+
+#include <unistd.h>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/system/system_error.hpp>
+
+#include <ftp/ftp.hpp>
 
 #include "logger.hpp"
 
@@ -20,79 +34,226 @@ namespace rs
 namespace ftp
 {
 
-static std::regex const codes_regex{"(\\d{3})"};
-static std::regex const ipv4_regex{R"###((\d{1,3})\.(\d{1,3})\.(\d{1,3})\.(\d{1,3}))###"};
-static std::regex const pasv_reply_regex{R"###(\((\d{1,3}),(\d{1,3}),(\d{1,3}),(\d{1,3}),(\d{1,3}),(\d{1,3})\))###"};
-static std::regex const epsv_reply_regex{R"###(\(\|([12])?\|(.+)?\|([0-9]{1,5})\|\))###"};
+/**
+ * @brief Parses an unsigned decimal number of at most a_max_digits digits off the front of a_str.
+ *
+ * @param[in,out] a_str The number is removed on success.
+ * @param[in] a_max_digits
+ * @param[out] a_value
+ *
+ * @returns false if a_str does not start with such a number.
+ */
+template <typename Number>
+inline auto consume_number(
+    std::string_view& a_str,
+    std::size_t a_max_digits,
+    Number& a_value
+)
+noexcept -> bool
+{
+    auto const begin = a_str.data();
+    auto const end = begin + std::min(a_str.size(), a_max_digits);
+    auto const [last, error] = std::from_chars(begin, end, a_value);
+
+    // NOTE - from_chars takes a leading minus for signed types.
+    if (error != std::errc{} || last == begin || *begin == '-')
+    {
+        return false;
+    }
 
-inline auto parse_codes(
-    std::string const& a_reply_str
-) noexcept
--> std::vector<reply_code>
+    if (last == end && a_str.size() > a_max_digits &&
+        a_str[a_max_digits] >= '0' && a_str[a_max_digits] <= '9')
+    {
+        return false;
+    }
+
+    a_str.remove_prefix(last - begin);
+    return true;
+}
+
+inline auto consume_char(std::string_view& a_str, char a_char) noexcept -> bool
 {
-    std::smatch codes_match;
-    std::vector<reply_code> ret_codes;
-    std::string search_str{a_reply_str};
+    if (a_str.empty() || a_str.front() != a_char)
+    {
+        return false;
+    }
+
+    a_str.remove_prefix(1);
+    return true;
+}
+
+/**
+ * @brief The code a reply starts with - "xyz text" or, for multi-line replies, "xyz-text".
+ *
+ * @param[in] a_reply_str
+ *
+ * @returns std::nullopt if a_reply_str does not start with a code.
+ */
+inline auto parse_reply_code(
+    std::string_view a_reply_str
+)
+noexcept -> std::optional<reply_code>
+{
+    if (a_reply_str.size() < 3)
+    {
+        return std::nullopt;
+    }
+
+    int code{0};
+
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        if (a_reply_str[i] < '0' || a_reply_str[i] > '9')
+        {
+            return std::nullopt;
+        }
+
+        code = (code * 10) + (a_reply_str[i] - '0');
+    }
+
+    if (a_reply_str.size() > 3 && a_reply_str[3] != ' ' && a_reply_str[3] != '-' &&
+        a_reply_str[3] != '\r' && a_reply_str[3] != '\n')
+    {
+        return std::nullopt;
+    }
 
     // NOTE - Even if we get an invalid reply_code nothing scary should happen.
-    while (std::regex_search(search_str, codes_match, codes_regex))
+    return static_cast<reply_code>(code);
+}
+
+/**
+ * @brief Size of the complete reply at the front of a_buffer, CRLF included.
+ *
+ * A multi-line reply starts with "xyz-" and ends with the first line that starts with "xyz "
+ * (RFC959 4.2), the lines between may start with anything - other codes included.
+ *
+ * @param[in] a_buffer What was received so far, possibly more than one reply.
+ *
+ * @returns 0 if the reply is not complete yet.
+ */
+inline auto reply_size(
+    std::string_view a_buffer
+)
+noexcept -> std::size_t
+{
+    auto line_end = a_buffer.find(CRLF);
+
+    if (line_end == std::string_view::npos)
+    {
+        return 0;
+    }
+
+    if (line_end < 4 || a_buffer[3] != '-')
+    {
+        return line_end + CRLF.size();
+    }
+
+    auto const code{a_buffer.substr(0, 3)};
+
+    while (true)
+    {
+        auto const line_begin = line_end + CRLF.size();
+        line_end = a_buffer.find(CRLF, line_begin);
+
+        if (line_end == std::string_view::npos)
+        {
+            return 0;
+        }
+
+        auto const line{a_buffer.substr(line_begin, line_end - line_begin)};
+
+        if (line.size() >= 4 && line.substr(0, 3) == code && line[3] == ' ')
+        {
+            return line_end + CRLF.size();
+        }
+    }
+}
+
+inline auto is_service_not_available(std::string_view a_reply_str) noexcept -> bool
+{
+    return parse_reply_code(a_reply_str) == reply_code::SERVICE_NOT_AVAILABLE_421;
+}
+
+/**
+ * @brief Whether a_error is a reply_error saying the command is not implemented or not understood.
+ */
+inline auto is_not_implemented(std::exception_ptr a_error) noexcept -> bool
+{
+    try
+    {
+        std::rethrow_exception(a_error);
+    } catch (reply_error const& e)
     {
-        ret_codes.push_back(static_cast<reply_code>(std::stoi(codes_match.str())));
-        search_str = codes_match.suffix();
+        return e.code() == reply_code::COMMAND_SYNTAX_ERROR_500 ||
+               e.code() == reply_code::COMMAND_NOT_IMPLEMENTED_502 ||
+               e.code() == reply_code::COMMAND_NOT_IMPLEMENTED_FOR_PARAMETER_504;
+    } catch (...)
+    {
+        return false;
     }
+}
 
-    return ret_codes;
+/**
+ * @brief Whether a_error is a reply_error - the reply was read in full, so the control connection
+ *        is still in sync.
+ */
+inline auto is_reply_error(std::exception_ptr a_error) noexcept -> bool
+{
+    try
+    {
+        std::rethrow_exception(a_error);
+    } catch (reply_error const&)
+    {
+        return true;
+    } catch (...)
+    {
+        return false;
+    }
 }
 
 inline auto check_success(
-    std::vector<reply_code> const& a_accepted_codes,
-    std::string const& a_reply_str
+    reply_code_set const& a_accepted_codes,
+    std::string_view a_reply_str
 )
 -> void
 {
-    auto returned_codes = parse_codes(a_reply_str);
+    auto const code = parse_reply_code(a_reply_str);
 
-    if (returned_codes.empty())
+    if (!code)
     {
         throw std::runtime_error("No reply codes returned - invalid response");
     }
 
-    std::vector<reply_code> matched;
-
-    std::set_intersection(
-        a_accepted_codes.begin(),
-        a_accepted_codes.end(),
-        returned_codes.begin(),
-        returned_codes.end(),
-        std::back_inserter(matched)
-    );
-
-    if (matched.empty())
+    // NOTE - Only the code the reply starts with counts - the text, and the lines of a multi-line
+    //        reply, may hold any number.
+    if (!a_accepted_codes.contains(*code))
     {
-        throw std::runtime_error("No reply codes matched - operation failed");
+        throw reply_error("No reply codes matched - operation failed", *code);
     }
 }
 
 inline auto parse_ipv4(
-    std::string const& a_ip_str
+    std::string_view a_ip_str
 )
--> std::vector<int>
+-> std::array<int, 4>
 {
-    std::smatch ip_match;
+    std::array<int, 4> address{};
 
-    if (!std::regex_match(a_ip_str, ip_match, ipv4_regex) || ip_match.size() < 4)
+    for (std::size_t i = 0; i < address.size(); ++i)
     {
-        throw std::runtime_error("Failed to parse IP address");
+        if ((i > 0 && !consume_char(a_ip_str, '.')) ||
+            !consume_number(a_ip_str, 3, address[i]) || address[i] > 255)
+        {
+            throw std::runtime_error("Failed to parse IP address");
+        }
     }
 
-    logger::debug(ip_match[0]);
+    if (!a_ip_str.empty())
+    {
+        throw std::runtime_error("Failed to parse IP address");
+    }
 
-    return {
-        std::stoi(ip_match[1]),
-        std::stoi(ip_match[2]),
-        std::stoi(ip_match[3]),
-        std::stoi(ip_match[4])
-    };
+    return address;
 }
 
 inline auto port_to_network(unsigned short a_port) noexcept
@@ -101,48 +262,61 @@ inline auto port_to_network(unsigned short a_port) noexcept
     return std::make_tuple(a_port >> 8, a_port);
 }
 
+/**
+ * @brief Parses "227 Entering Passive Mode (h1,h2,h3,h4,p1,p2)".
+ *
+ * @param[in] a_pasv_reply
+ *
+ * @throws std::runtime_error If the reply holds no address
+ *
+ * @returns The address and the port.
+ */
 inline auto parse_pasv_ipv4_port_reply(
-    std::string const& a_pasv_reply
+    std::string_view a_pasv_reply
 )
--> std::tuple<std::vector<int>, unsigned short>
+-> std::tuple<std::array<int, 4>, unsigned short>
 {
-    std::smatch ip_port_match;
-
-    if (!std::regex_search(a_pasv_reply, ip_port_match, pasv_reply_regex) ||
-        ip_port_match.size() < 6)
+    for (auto open = a_pasv_reply.find('(');
+         open != std::string_view::npos;
+         open = a_pasv_reply.find('(', open + 1))
     {
-        throw std::runtime_error("Failed to parse PASV reply");
+        auto rest{a_pasv_reply.substr(open + 1)};
+        std::array<int, 6> numbers{};
+        bool valid{true};
+
+        for (std::size_t i = 0; valid && i < numbers.size(); ++i)
+        {
+            valid = (i == 0 || consume_char(rest, ',')) &&
+                consume_number(rest, 3, numbers[i]) && numbers[i] <= 255;
+        }
+
+        if (valid && consume_char(rest, ')'))
+        {
+            return std::make_tuple(
+                std::array<int, 4>{numbers[0], numbers[1], numbers[2], numbers[3]},
+                static_cast<unsigned short>((256 * numbers[4]) + numbers[5])
+            );
+        }
     }
 
-    std::vector<int> address{
-        std::stoi(ip_port_match[1]),
-        std::stoi(ip_port_match[2]),
-        std::stoi(ip_port_match[3]),
-        std::stoi(ip_port_match[4])
-    };
-    unsigned short port = (256 * std::stoi(ip_port_match[5])) + std::stoi(ip_port_match[6]);
-
-    return std::make_tuple(
-        address,
-        port
-    );
+    throw std::runtime_error("Failed to parse PASV reply");
 }
 
-inline auto ipv4_vec_to_str(std::vector<int> const& a_ip_vec) noexcept -> std::string
+inline auto ipv4_vec_to_str(std::array<int, 4> const& a_ip_vec) -> std::string
 {
-    assert(a_ip_vec.size() == 4 && "vector too short or too long");
+    std::string ret;
 
-    std::ostringstream ss;
+    for (auto const octet : a_ip_vec)
+    {
+        if (!ret.empty())
+        {
+            ret += '.';
+        }
 
-    ss << a_ip_vec[0]
-       << "."
-       << a_ip_vec[1]
-       << "."
-       << a_ip_vec[2]
-       << "."
-       << a_ip_vec[3];
+        ret += std::to_string(octet);
+    }
 
-    return ss.str();
+    return ret;
 }
 
 struct epsv_reply
@@ -154,31 +328,211 @@ struct epsv_reply
     unsigned short port{DEFAULT_DATA_CONNECTION_PORT};
 };
 
+/**
+ * @brief Parses "229 Entering Extended Passive Mode (|||port|)" - RFC2428.
+ *
+ * @param[in] a_epsv_reply
+ *
+ * @throws std::runtime_error If the reply holds no port
+ */
 inline auto parse_epsv_reply(
-    std::string const& a_epsv_reply
+    std::string_view a_epsv_reply
 )
 -> epsv_reply
 {
-    std::smatch match;
+    for (auto open = a_epsv_reply.find("(|");
+         open != std::string_view::npos;
+         open = a_epsv_reply.find("(|", open + 1))
+    {
+        auto rest{a_epsv_reply.substr(open + 2)};
+        epsv_reply reply;
+
+        // NOTE - AF_INET6 is also a macro, str_to_address_family keeps it out of this header.
+        if (!rest.empty() && (rest.front() == '1' || rest.front() == '2'))
+        {
+            reply.family = str_to_address_family(std::string(1, rest.front()));
+            rest.remove_prefix(1);
+        }
+
+        if (!consume_char(rest, '|'))
+        {
+            continue;
+        }
+
+        auto const address_end = rest.find('|');
+
+        if (address_end == std::string_view::npos)
+        {
+            continue;
+        }
+
+        reply.address = rest.substr(0, address_end);
+        rest.remove_prefix(address_end + 1);
+
+        if (consume_number(rest, 5, reply.port) && consume_char(rest, '|') &&
+            consume_char(rest, ')'))
+        {
+            return reply;
+        }
+    }
+
+    throw std::runtime_error("Failed to parse EPSV reply");
+}
 
-    if (!std::regex_search(a_epsv_reply, match, epsv_reply_regex) || match.size() < 2)
+/**
+ * Owns a POSIX file descriptor.
+ */
+class file_descriptor
+{
+public:
+    explicit file_descriptor(int a_fd) noexcept :
+        m_fd(a_fd)
+    { }
+
+    ~file_descriptor() noexcept
     {
-        throw std::runtime_error("Failed to parse EPSV reply");
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
     }
 
-    epsv_reply reply;
+    file_descriptor(file_descriptor const&) =delete;
+    auto operator=(file_descriptor const&) -> file_descriptor& =delete;
 
+    auto get() const noexcept -> int
+    {
+        return m_fd;
+    }
+
+private:
+    int m_fd;
+};
+
+/**
+ * @brief Size of the local file at a_local_path.
+ *
+ * @throws std::runtime_error The file could not be opened.
+ */
+inline auto local_file_size(std::string const& a_local_path) -> std::size_t
+{
+    std::ifstream ifs(a_local_path, std::ios::binary | std::ios::ate);
 
-    if (!match[1].str().empty())
+    if (!ifs)
     {
+        throw std::runtime_error("Failed to open " + a_local_path);
+    }
+
+    return static_cast<std::size_t>(ifs.tellg());
+}
 
-        reply.family = str_to_address_family(match[1].str());
+/**
+ * @brief Throws if the owner of a_io_context stopped it - a blocking call does not undo that.
+ *
+ * @throws boost::system::system_error operation_aborted
+ */
+inline auto throw_if_stopped(boost::asio::io_context const& a_io_context) -> void
+{
+    if (a_io_context.stopped())
+    {
+        throw boost::system::system_error(
+            boost::asio::error::operation_aborted,
+            "The reactor was stopped"
+        );
     }
+}
+
+// NOTE - The reactor may be shared with other clients, so blocking calls drive it only until their
+//        own operation completes. Handlers of the other users of the reactor make progress in the
+//        meantime. A reactor stops once it runs out of work too - the stop this call caused by
+//        running the last handler is undone, so the next call tells it from a stop() of the owner.
+inline auto run_until(
+    boost::asio::io_context& a_io_context,
+    bool const& a_done
+)
+-> void
+{
+    while (!a_done)
+    {
+        // NOTE - Stopped by its owner, or out of work - the operation can no longer complete.
+        if (a_io_context.run_one() == 0 && !a_done)
+        {
+            throw boost::system::system_error(
+                boost::asio::error::operation_aborted,
+                "The reactor stopped before the operation completed"
+            );
+        }
+    }
+
+    if (a_io_context.stopped())
+    {
+        a_io_context.restart();
+    }
+}
+
+// NOTE - The state is shared with the completion handler - if a handler of another user of the
+//        reactor throws out of run_until, the pending handler still writes to live memory.
+inline auto run_blocking(
+    boost::asio::io_context& a_io_context,
+    std::function<void(std::function<void(std::exception_ptr)>)> const& a_start
+)
+-> void
+{
+    struct state
+    {
+        bool done{false};
+        std::exception_ptr error{};
+    };
+
+    throw_if_stopped(a_io_context);
 
-    reply.address = match[2];
-    reply.port = std::stoi(match[3]);
+    auto const operation{std::make_shared<state>()};
+
+    a_start([operation](std::exception_ptr a_error) -> void
+    {
+        operation->error = a_error;
+        operation->done = true;
+    });
+    run_until(a_io_context, operation->done);
+
+    if (operation->error)
+    {
+        std::rethrow_exception(operation->error);
+    }
+}
+
+template <typename Result>
+inline auto run_blocking(
+    boost::asio::io_context& a_io_context,
+    std::function<void(std::function<void(std::exception_ptr, Result)>)> const& a_start
+)
+-> Result
+{
+    struct state
+    {
+        bool done{false};
+        std::exception_ptr error{};
+        Result result{};
+    };
+
+    throw_if_stopped(a_io_context);
+
+    auto const operation{std::make_shared<state>()};
+
+    a_start([operation](std::exception_ptr a_error, Result a_result) -> void
+    {
+        operation->error = a_error;
+        operation->result = std::move(a_result);
+        operation->done = true;
+    });
+    run_until(a_io_context, operation->done);
+
+    if (operation->error)
+    {
+        std::rethrow_exception(operation->error);
+    }
 
-    return reply;
+    return std::move(operation->result);
 }
 
 }   // namespace ftp
@@ -1,10 +1,71 @@
 #include <catch2/catch.hpp>
 
+#include <thread>
+#include <algorithm>
 #include <fstream>
+#include <iterator>
+#include <sstream>
+#include <streambuf>
+#include <stdexcept>
+#include <filesystem>
+#include <system_error>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <boost/asio/use_future.hpp>
 
 #include <ftp/ftp.hpp>
 
 
+// NOTE - Joins the thread however the test leaves its scope - a failed REQUIRE throws.
+class reactor_thread
+{
+public:
+    explicit reactor_thread(boost::asio::io_context& a_io_context) :
+        m_io_context(a_io_context),
+        m_work(boost::asio::make_work_guard(a_io_context)),
+        m_thread([&a_io_context]() { a_io_context.run(); })
+    { }
+
+    ~reactor_thread()
+    {
+        m_work.reset();
+        m_io_context.stop();
+        m_thread.join();
+    }
+
+    reactor_thread(reactor_thread const&) =delete;
+    auto operator=(reactor_thread const&) -> reactor_thread& =delete;
+
+private:
+    boost::asio::io_context& m_io_context;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_work;
+    std::thread m_thread;
+};
+
+// NOTE - Hands out a_size bytes, then fails like a disk read error - the stream goes bad.
+class failing_streambuf : public std::streambuf
+{
+public:
+    explicit failing_streambuf(std::size_t a_size) :
+        m_data(a_size, 'f')
+    {
+        setg(m_data.data(), m_data.data(), m_data.data() + m_data.size());
+    }
+
+protected:
+    auto underflow() -> int_type override
+    {
+        throw std::runtime_error("read error");
+    }
+
+private:
+    std::vector<char> m_data;
+};
+
 class logged_in_fixture
 {
 public:
@@ -63,6 +124,40 @@ TEST_CASE("Connection test", "[ftp][connect]")
         rs::ftp::client client(opts);
         REQUIRE_THROWS(client.connect());
     }
+
+    SECTION("Cached resolution")
+    {
+        rs::ftp::connection_options opts;
+        opts.server_hostname = "localhost";
+        opts.server_port = 21;
+        opts.debug_output = true;
+
+        rs::ftp::client first(opts);
+        REQUIRE_NOTHROW(first.connect());
+
+        rs::ftp::client second(opts);
+        REQUIRE_NOTHROW(second.connect());
+
+        opts.resolve_cache_ttl = std::chrono::seconds(0);
+        rs::ftp::client uncached(opts);
+        REQUIRE_NOTHROW(uncached.connect());
+    }
+
+    SECTION("Refused cached resolution")
+    {
+        rs::ftp::connection_options opts;
+        opts.server_hostname = "localhost";
+        opts.server_port = 3333;
+        opts.debug_output = true;
+
+        rs::ftp::client first(opts);
+        REQUIRE_THROWS(first.connect());
+
+        // NOTE - Refused again after dropping the cached addresses and resolving once more.
+        rs::ftp::client second(opts);
+        REQUIRE_THROWS(second.connect());
+        REQUIRE_FALSE(second.is_open());
+    }
 }
 
 TEST_CASE("Login test", "[ftp][login]")
@@ -119,7 +214,23 @@ TEST_CASE_METHOD(logged_in_fixture, "RETR test", "[ftp][download][retr]")
 
     SECTION("Download to byte vector")
     {
-        REQUIRE_NOTHROW(m_client.download("image.jpeg"));
+        std::vector<char> data;
+        REQUIRE_NOTHROW(data = m_client.download("image.jpeg"));
+        REQUIRE(data.size() == 59882);
+        // NOTE - Allocated once from the SIZE reply, not grown with the data.
+        REQUIRE(data.capacity() == data.size());
+    }
+
+    SECTION("Download with tuned data sockets")
+    {
+        opts.data_socket.receive_buffer_size = 4 << 20;
+        opts.data_socket.keep_alive = true;
+        opts.data_socket.keep_alive_idle = std::chrono::seconds(30);
+        opts.data_socket.quick_ack = true;
+        opts.data_socket.type_of_service = 0x20;
+        m_client.set_connection_options(opts);
+
+        REQUIRE(m_client.download("image.jpeg").size() == 59882);
     }
 
     SECTION("Download to a file")
@@ -127,13 +238,303 @@ TEST_CASE_METHOD(logged_in_fixture, "RETR test", "[ftp][download][retr]")
         std::ofstream out("image.jpeg", std::ios::binary);
         REQUIRE_NOTHROW(m_client.download("image.jpeg", out));
     }
+
+    SECTION("Download to a sink")
+    {
+        auto const expected = m_client.download("image.jpeg");
+        std::vector<char> received;
+
+        REQUIRE_NOTHROW(m_client.download("image.jpeg", [&](char const* a_data, std::size_t a_size)
+        {
+            received.insert(received.end(), a_data, a_data + a_size);
+        }));
+        REQUIRE(received == expected);
+
+        REQUIRE_THROWS_AS(
+            m_client.download("image.jpeg", [](char const*, std::size_t)
+            {
+                throw std::out_of_range("sink failed");
+            }),
+            std::out_of_range
+        );
+        REQUIRE_NOTHROW(m_client.noop());
+    }
+
+    SECTION("Download into a buffer")
+    {
+        auto const expected = m_client.download("image.jpeg");
+        REQUIRE(expected.size() == 59882);
+
+        std::vector<char> exact(expected.size());
+        REQUIRE(m_client.download("image.jpeg", exact.data(), exact.size()) == expected.size());
+        REQUIRE(exact == expected);
+
+        std::vector<char> larger(expected.size() + 100);
+        REQUIRE(m_client.download("image.jpeg", larger.data(), larger.size()) == expected.size());
+        REQUIRE(std::equal(expected.begin(), expected.end(), larger.begin()));
+
+        std::vector<char> smaller(expected.size() - 1);
+        REQUIRE_THROWS_AS(
+            m_client.download("image.jpeg", smaller.data(), smaller.size()),
+            std::length_error
+        );
+        REQUIRE_NOTHROW(m_client.noop());
+    }
+
+    SECTION("Download to a path")
+    {
+        auto const expected = m_client.download("image.jpeg");
+
+        REQUIRE_NOTHROW(m_client.download("image.jpeg", std::filesystem::path("spliced.jpeg")));
+
+        std::ifstream in("spliced.jpeg", std::ios::binary);
+        REQUIRE(std::vector<char>(std::istreambuf_iterator<char>(in), {}) == expected);
+        REQUIRE(std::filesystem::file_size("spliced.jpeg") == expected.size());
+    }
+
+    SECTION("Download to a pipe")
+    {
+        auto const expected = m_client.download("image.jpeg");
+
+        int fds[2];
+        REQUIRE(::pipe(fds) == 0);
+
+        std::vector<char> received;
+        std::thread reader([&]()
+        {
+            char buffer[4096];
+            for (ssize_t result; (result = ::read(fds[0], buffer, sizeof(buffer))) > 0;)
+            {
+                received.insert(received.end(), buffer, buffer + result);
+            }
+        });
+
+        // NOTE - Not REQUIRE - the reader has to be joined however the download ends.
+        CHECK_NOTHROW(m_client.download("image.jpeg", fds[1]));
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+
+        REQUIRE(received == expected);
+    }
+
+    SECTION("Download to a file that cannot be written")
+    {
+        std::ofstream("unwritable.jpeg").put('x');
+        auto const fd = ::open("unwritable.jpeg", O_RDONLY);
+        REQUIRE(fd >= 0);
+
+        REQUIRE_THROWS(m_client.download("image.jpeg", fd));
+        ::close(fd);
+        std::filesystem::remove("unwritable.jpeg");
+
+        // NOTE - The transfer reply of the failed download was read, not left for the next command.
+        REQUIRE_NOTHROW(m_client.noop());
+        REQUIRE(m_client.download("documents/document1.txt").size() == 446);
+    }
+
+    SECTION("Download a missing file to a path")
+    {
+        std::filesystem::remove("missing.jpeg");
+        REQUIRE_THROWS(m_client.download("1337.jpeg", std::filesystem::path("missing.jpeg")));
+        REQUIRE(m_client.is_open());
+        REQUIRE_FALSE(std::filesystem::exists("missing.jpeg"));
+        REQUIRE_FALSE(std::filesystem::exists("missing.jpeg.part"));
+
+        // NOTE - A file already there is not the download's to remove.
+        std::ofstream("missing.jpeg") << "kept";
+        REQUIRE_THROWS(m_client.download("1337.jpeg", std::filesystem::path("missing.jpeg")));
+        REQUIRE(std::filesystem::file_size("missing.jpeg") == 4);
+        std::filesystem::remove("missing.jpeg");
+    }
+
+    SECTION("Download files back to back")
+    {
+        std::vector<std::size_t> sizes(3);
+        auto count = [&](std::size_t a_index, char const*, std::size_t a_size)
+        {
+            sizes[a_index] += a_size;
+        };
+
+        REQUIRE_NOTHROW(m_client.download_files(
+            {"image.jpeg", "documents/document1.txt", "image.jpeg"},
+            count
+        ));
+        REQUIRE(sizes == std::vector<std::size_t>{59882, 446, 59882});
+
+        REQUIRE_THROWS(m_client.download_files({"image.jpeg", "1337.jpeg", "image.jpeg"}, count));
+        REQUIRE_NOTHROW(m_client.noop());
+    }
+
+    SECTION("Download files slower than the timeout")
+    {
+        std::vector<char> const large(16 << 20, 'l');
+        std::istringstream in(std::string(large.begin(), large.end()));
+        REQUIRE_NOTHROW(m_client.upload("large.bin", in));
+
+        // NOTE - With a small window the server only sends the transfer reply once most of the
+        //        data is drained, reading it times out.
+        opts.timeout = std::chrono::milliseconds(300);
+        opts.data_socket.receive_buffer_size = 65536;
+        rs::ftp::client client(opts);
+        REQUIRE_NOTHROW(client.connect());
+        REQUIRE_NOTHROW(client.login());
+
+        std::vector<std::size_t> sizes(2);
+        REQUIRE_NOTHROW(client.download_files(
+            {"large.bin", "documents/document1.txt"},
+            [&](std::size_t a_index, char const*, std::size_t a_size)
+            {
+                sizes[a_index] += a_size;
+                std::this_thread::sleep_for(std::chrono::milliseconds(3));
+            }
+        ));
+        REQUIRE(sizes == std::vector<std::size_t>{large.size(), 446});
+        REQUIRE_NOTHROW(client.noop());
+        REQUIRE_NOTHROW(client.remove_file("large.bin"));
+    }
+
+    SECTION("Download files with pipelined passive mode")
+    {
+        opts.pipeline_passive_mode = true;
+        m_client.set_connection_options(opts);
+
+        std::vector<std::size_t> sizes(3);
+        auto count = [&](std::size_t a_index, char const*, std::size_t a_size)
+        {
+            sizes[a_index] += a_size;
+        };
+
+        REQUIRE_NOTHROW(m_client.download_files(
+            {"image.jpeg", "documents/document1.txt", "image.jpeg"},
+            count
+        ));
+        REQUIRE(sizes == std::vector<std::size_t>{59882, 446, 59882});
+
+        // NOTE - Fails with the EPSV for the second file already sent.
+        REQUIRE_THROWS_AS(
+            m_client.download_files(
+                {"image.jpeg", "image.jpeg"},
+                [](std::size_t, char const*, std::size_t)
+                {
+                    throw std::out_of_range("sink failed");
+                }
+            ),
+            std::out_of_range
+        );
+        REQUIRE_NOTHROW(m_client.noop());
+        REQUIRE_NOTHROW(m_client.noop());
+
+        REQUIRE_THROWS(m_client.download_files({"image.jpeg", "1337.jpeg", "image.jpeg"}, count));
+        REQUIRE_NOTHROW(m_client.noop());
+        REQUIRE_NOTHROW(m_client.noop());
+    }
 }
 
 TEST_CASE_METHOD(logged_in_fixture, "Upload test", "[ftp][stor]")
 {
-    std::ifstream in("image.jpeg", std::ios::binary);
-    REQUIRE(in.is_open());
-    REQUIRE_NOTHROW(m_client.upload("pustiniaks.jpeg", in));
+    SECTION("Upload from a stream")
+    {
+        std::ifstream in("image.jpeg", std::ios::binary);
+        REQUIRE(in.is_open());
+        REQUIRE_NOTHROW(m_client.upload("pustiniaks.jpeg", in));
+    }
+
+    SECTION("Upload from a stream that fails half way")
+    {
+        failing_streambuf buffer(20000);
+        std::istream in(&buffer);
+
+        REQUIRE_THROWS(m_client.upload("half_way.bin", in));
+        REQUIRE(in.bad());
+
+        // NOTE - The transfer reply of the failed upload was read, not left for the next command.
+        REQUIRE_NOTHROW(m_client.noop());
+        REQUIRE_NOTHROW(m_client.remove_file("half_way.bin"));
+    }
+
+    SECTION("Upload a file")
+    {
+        std::ifstream in("image.jpeg", std::ios::binary);
+        std::vector<char> const expected{std::istreambuf_iterator<char>(in), {}};
+
+        REQUIRE_NOTHROW(m_client.upload("sendfile.jpeg", std::filesystem::path("image.jpeg")));
+        REQUIRE(m_client.download("sendfile.jpeg") == expected);
+        REQUIRE_NOTHROW(m_client.remove_file("sendfile.jpeg"));
+    }
+
+    SECTION("Upload from a pipe")
+    {
+        std::vector<char> expected(200000);
+        for (std::size_t i = 0; i < expected.size(); ++i)
+        {
+            expected[i] = static_cast<char>(i % 251);
+        }
+
+        int fds[2];
+        REQUIRE(::pipe(fds) == 0);
+
+        std::thread writer([&]()
+        {
+            // NOTE - A failed upload closes the read end - fail the write instead of the process.
+            sigset_t pipe_signal;
+            sigemptyset(&pipe_signal);
+            sigaddset(&pipe_signal, SIGPIPE);
+            pthread_sigmask(SIG_BLOCK, &pipe_signal, nullptr);
+
+            for (std::size_t written = 0; written < expected.size();)
+            {
+                auto const result = ::write(
+                    fds[1],
+                    expected.data() + written,
+                    expected.size() - written
+                );
+                if (result <= 0)
+                {
+                    break;
+                }
+                written += static_cast<std::size_t>(result);
+            }
+            ::close(fds[1]);
+        });
+
+        // NOTE - Not REQUIRE - the writer has to be joined however the upload ends.
+        CHECK_NOTHROW(m_client.upload("piped.bin", fds[0]));
+        ::close(fds[0]);
+        writer.join();
+
+        REQUIRE(m_client.download("piped.bin") == expected);
+        REQUIRE_NOTHROW(m_client.remove_file("piped.bin"));
+    }
+
+    SECTION("Upload a file that fails half way")
+    {
+        // NOTE - The peer closes with data of its own unread - reading the rest fails with
+        //        ECONNRESET after the data already queued was sent.
+        int fds[2];
+        REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        REQUIRE(::write(fds[0], "x", 1) == 1);
+
+        std::vector<char> const queued(50000, 'q');
+        REQUIRE(::write(fds[1], queued.data(), queued.size()) == 50000);
+        ::close(fds[1]);
+
+        REQUIRE_THROWS(m_client.upload("half_way.bin", fds[0]));
+        ::close(fds[0]);
+
+        // NOTE - The transfer reply of the failed upload was read, not left for the next command.
+        REQUIRE_NOTHROW(m_client.noop());
+        REQUIRE_NOTHROW(m_client.remove_file("half_way.bin"));
+    }
+
+    SECTION("Upload a missing file")
+    {
+        REQUIRE_THROWS_AS(
+            m_client.upload("missing.jpeg", std::filesystem::path("i_dont_exist.jpeg")),
+            std::system_error
+        );
+        REQUIRE(m_client.is_open());
+    }
 }
 
 TEST_CASE_METHOD(logged_in_fixture, "Rename test", "[ftp][rnfr][rnto][rename]")
@@ -178,12 +579,59 @@ TEST_CASE_METHOD(logged_in_fixture, "LS test", "[ftp][ls][nlst]")
         REQUIRE_NOTHROW(m_client.ls("documents"));
     }
 
+    SECTION("LS returns every name")
+    {
+        auto const names = m_client.ls();
+
+        REQUIRE(names.find("image.jpeg") != std::string::npos);
+        REQUIRE(names.find("documents") != std::string::npos);
+    }
+
     SECTION("LS invalid directory")
     {
         REQUIRE_THROWS(m_client.ls("i_dont_exist_neither_should_you"));
     }
 }
 
+TEST_CASE_METHOD(logged_in_fixture, "List directory test", "[ftp][mlsd][list]")
+{
+    SECTION("Valid directory")
+    {
+        auto const listing = m_client.list_directory("");
+        auto const image = std::find_if(listing.begin(), listing.end(),
+            [](rs::ftp::listing_entry const& a_entry) { return a_entry.name == "image.jpeg"; });
+
+        REQUIRE(image != listing.end());
+        REQUIRE(image->type == rs::ftp::entry_type::FILE);
+        REQUIRE(image->size == 59882);
+        REQUIRE(image->modify.has_value());
+
+        auto const documents = std::find_if(listing.begin(), listing.end(),
+            [](rs::ftp::listing_entry const& a_entry) { return a_entry.name == "documents"; });
+
+        REQUIRE(documents != listing.end());
+        REQUIRE(documents->type == rs::ftp::entry_type::DIRECTORY);
+    }
+
+    SECTION("Streamed")
+    {
+        std::vector<std::string> names;
+
+        REQUIRE_NOTHROW(m_client.list_directory("", [&names](rs::ftp::listing_entry const& a_entry)
+        {
+            names.emplace_back(a_entry.name);
+        }));
+
+        REQUIRE(names.size() == m_client.list_directory("").size());
+        REQUIRE(std::find(names.begin(), names.end(), "image.jpeg") != names.end());
+    }
+
+    SECTION("Invalid directory")
+    {
+        REQUIRE_THROWS(m_client.list_directory("i_dont_exist_neither_should_you"));
+    }
+}
+
 TEST_CASE_METHOD(logged_in_fixture, "System info test", "[ftp][syst]")
 {
     REQUIRE_NOTHROW(m_client.system_info());
@@ -194,3 +642,145 @@ TEST_CASE_METHOD(logged_in_fixture, "Progress test", "[ftp][stat][progress]")
     REQUIRE_NOTHROW(m_client.progress());
 }
 
+
+TEST_CASE_METHOD(logged_in_fixture, "Features test", "[ftp][feat]")
+{
+    auto const features = m_client.features();
+
+    REQUIRE(std::find(features.begin(), features.end(), "SIZE") != features.end());
+    REQUIRE(std::find(features.begin(), features.end(), "REST STREAM") != features.end());
+    REQUIRE_NOTHROW(m_client.noop());
+}
+
+TEST_CASE("Shared reactor test", "[ftp][io_context]")
+{
+    rs::ftp::connection_options opts;
+    opts.username = "admin";
+    opts.password = "admin";
+    opts.server_hostname = "localhost";
+    opts.server_port = 21;
+    opts.debug_output = true;
+
+    boost::asio::io_context io_context;
+    rs::ftp::client first(io_context, opts);
+    rs::ftp::client second(io_context, opts);
+
+    REQUIRE_NOTHROW(first.connect());
+    REQUIRE_NOTHROW(second.connect());
+    REQUIRE_NOTHROW(first.login());
+    REQUIRE_NOTHROW(second.login());
+    REQUIRE_NOTHROW(first.download("documents/document1.txt"));
+    REQUIRE_NOTHROW(second.ls());
+
+    // NOTE - A stop() of the owner is not undone by a blocking call.
+    io_context.stop();
+    REQUIRE_THROWS_AS(first.noop(), boost::system::system_error);
+    REQUIRE(io_context.stopped());
+    io_context.restart();
+    REQUIRE_NOTHROW(first.noop());
+
+    REQUIRE_NOTHROW(first.close());
+    REQUIRE_NOTHROW(second.close());
+}
+
+TEST_CASE("Asynchronous API test", "[ftp][async]")
+{
+    rs::ftp::connection_options opts;
+    opts.username = "admin";
+    opts.password = "admin";
+    opts.server_hostname = "localhost";
+    opts.server_port = 21;
+    opts.debug_output = true;
+
+    boost::asio::io_context io_context;
+    rs::ftp::client client(io_context, opts);
+
+    SECTION("Callbacks")
+    {
+        std::exception_ptr error;
+        std::vector<char> data;
+
+        client.async_connect([&](std::exception_ptr a_error)
+        {
+            if ((error = a_error))
+            {
+                return;
+            }
+
+            client.async_login([&](std::exception_ptr a_error)
+            {
+                if ((error = a_error))
+                {
+                    return;
+                }
+
+                client.async_download(
+                    "documents/document1.txt",
+                    [&](std::exception_ptr a_error, std::vector<char> a_data)
+                    {
+                        error = a_error;
+                        data = std::move(a_data);
+                    }
+                );
+            });
+        });
+
+        io_context.run();
+
+        REQUIRE_FALSE(error);
+        REQUIRE_FALSE(data.empty());
+    }
+
+    SECTION("Futures")
+    {
+        reactor_thread reactor(io_context);
+
+        REQUIRE_NOTHROW(client.async_connect(boost::asio::use_future).get());
+        REQUIRE_NOTHROW(client.async_login(boost::asio::use_future).get());
+        REQUIRE_FALSE(client.async_pwd(boost::asio::use_future).get().empty());
+
+        std::size_t received{0};
+        auto counter = [&received](char const*, std::size_t a_size) { received += a_size; };
+        REQUIRE_NOTHROW(client.async_download(
+            "documents/document1.txt",
+            counter,
+            boost::asio::use_future
+        ).get());
+        REQUIRE(received == 446);
+        REQUIRE_THROWS(client.async_cwd("i_dont_exist", boost::asio::use_future).get());
+        REQUIRE_NOTHROW(client.async_close(boost::asio::use_future).get());
+    }
+}
+
+TEST_CASE_METHOD(logged_in_fixture, "Command batch test", "[ftp][batch]")
+{
+    rs::ftp::command_batch batch;
+    for (int i = 0; i < 100; ++i)
+    {
+        batch.mkdir("batch_dir_" + std::to_string(i));
+    }
+    batch.rename("batch_dir_0", "batch_dir_renamed")
+         .rmdir("batch_dir_renamed")
+         .rmdir("non_existent_dir");
+    for (int i = 1; i < 100; ++i)
+    {
+        batch.rmdir("batch_dir_" + std::to_string(i));
+    }
+
+    std::vector<rs::ftp::command_reply> replies;
+    REQUIRE_NOTHROW(replies = m_client.execute(batch));
+    REQUIRE(replies.size() == batch.size());
+
+    for (std::size_t i = 0; i < replies.size(); ++i)
+    {
+        if (i == 103)
+        {
+            REQUIRE(replies[i].error);
+        } else
+        {
+            REQUIRE(!replies[i].error);
+        }
+    }
+
+    REQUIRE_NOTHROW(m_client.noop());
+}
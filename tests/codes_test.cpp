@@ -0,0 +1,25 @@
+#include <catch2/catch.hpp>
+
+#include <ftp/codes.hpp>
+
+
+TEST_CASE("Reply code set test", "[codes]")
+{
+    using rs::ftp::reply_code;
+
+    constexpr rs::ftp::reply_code_set accepted{
+        reply_code::RESTART_MARKER_110,
+        reply_code::FILE_STATUS_213,
+        reply_code::CONFIDENTIALITY_PROTECTED_REPLY_633
+    };
+
+    static_assert(accepted.contains(reply_code::FILE_STATUS_213));
+    static_assert(!accepted.contains(reply_code::SYSTEM_STATUS_211));
+
+    REQUIRE(accepted.contains(reply_code::RESTART_MARKER_110));
+    REQUIRE(accepted.contains(reply_code::CONFIDENTIALITY_PROTECTED_REPLY_633));
+    REQUIRE_FALSE(accepted.contains(reply_code::COMMAND_NOT_IMPLEMENTED_502));
+    REQUIRE_FALSE(accepted.contains(static_cast<reply_code>(99)));
+    REQUIRE_FALSE(accepted.contains(static_cast<reply_code>(700)));
+    REQUIRE_FALSE(rs::ftp::reply_code_set{}.contains(reply_code::FILE_STATUS_213));
+}
@@ -0,0 +1,170 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ftp/listing.hpp>
+
+
+static auto to_buffer(std::string const& a_listing) -> std::vector<char>
+{
+    return {a_listing.begin(), a_listing.end()};
+}
+
+static auto seconds_since_epoch(std::chrono::system_clock::time_point a_time) -> long long
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(a_time.time_since_epoch()).count();
+}
+
+TEST_CASE("MLSD parse test", "[listing][mlsd]")
+{
+    rs::ftp::listing_entry entry;
+
+    SECTION("File")
+    {
+        REQUIRE(rs::ftp::parse_mlsd_line(
+            "type=file;size=446;modify=20210131100000;perm=adfrw;unique=801U1; document1.txt",
+            entry
+        ));
+        REQUIRE(entry.name == "document1.txt");
+        REQUIRE(entry.type == rs::ftp::entry_type::FILE);
+        REQUIRE(entry.size == 446);
+        REQUIRE(entry.modify.has_value());
+        REQUIRE(seconds_since_epoch(*entry.modify) == 1612087200);
+        REQUIRE(entry.permissions == "adfrw");
+        REQUIRE(entry.unique == "801U1");
+    }
+
+    SECTION("Directory with a blank in the name")
+    {
+        REQUIRE(rs::ftp::parse_mlsd_line(
+            "Type=dir;Modify=20210131100000.123; my documents",
+            entry
+        ));
+        REQUIRE(entry.name == "my documents");
+        REQUIRE(entry.type == rs::ftp::entry_type::DIRECTORY);
+        REQUIRE_FALSE(entry.size.has_value());
+    }
+
+    SECTION("Current and parent directory")
+    {
+        REQUIRE_FALSE(rs::ftp::parse_mlsd_line("type=cdir; /home/admin", entry));
+        REQUIRE_FALSE(rs::ftp::parse_mlsd_line("type=pdir; /home", entry));
+    }
+
+    SECTION("Malformed")
+    {
+        REQUIRE_FALSE(rs::ftp::parse_mlsd_line("", entry));
+        REQUIRE_FALSE(rs::ftp::parse_mlsd_line("type=file;size=1;", entry));
+    }
+}
+
+TEST_CASE("LIST parse test", "[listing][list]")
+{
+    rs::ftp::listing_entry entry;
+
+    SECTION("Unix file with a year")
+    {
+        REQUIRE(rs::ftp::parse_list_line(
+            "-rw-r--r--    1 1000     1000        59882 Jan 31  2021 image.jpeg",
+            entry
+        ));
+        REQUIRE(entry.name == "image.jpeg");
+        REQUIRE(entry.type == rs::ftp::entry_type::FILE);
+        REQUIRE(entry.size == 59882);
+        REQUIRE(seconds_since_epoch(*entry.modify) == 1612051200);
+        REQUIRE(entry.permissions == "-rw-r--r--");
+    }
+
+    SECTION("Unix directory without a group")
+    {
+        REQUIRE(rs::ftp::parse_list_line("drwxr-xr-x 2 admin 4096 Mar 03 10:00 documents", entry));
+        REQUIRE(entry.name == "documents");
+        REQUIRE(entry.type == rs::ftp::entry_type::DIRECTORY);
+        REQUIRE(entry.size == 4096);
+        REQUIRE(entry.modify.has_value());
+    }
+
+    SECTION("Unix symlink")
+    {
+        REQUIRE(rs::ftp::parse_list_line(
+            "lrwxrwxrwx 1 root root 7 Jan 31 2021 latest -> v1.2.3",
+            entry
+        ));
+        REQUIRE(entry.name == "latest");
+        REQUIRE(entry.type == rs::ftp::entry_type::SYMLINK);
+    }
+
+    SECTION("DOS")
+    {
+        REQUIRE(rs::ftp::parse_list_line(
+            "01-31-21  10:00PM       <DIR>          documents",
+            entry
+        ));
+        REQUIRE(entry.name == "documents");
+        REQUIRE(entry.type == rs::ftp::entry_type::DIRECTORY);
+        REQUIRE(seconds_since_epoch(*entry.modify) == 1612130400);
+
+        REQUIRE(rs::ftp::parse_list_line("01-31-2021  10:00AM   446 document1.txt", entry));
+        REQUIRE(entry.name == "document1.txt");
+        REQUIRE(entry.type == rs::ftp::entry_type::FILE);
+        REQUIRE(entry.size == 446);
+    }
+
+    SECTION("Not entries")
+    {
+        REQUIRE_FALSE(rs::ftp::parse_list_line("total 12", entry));
+        REQUIRE_FALSE(rs::ftp::parse_list_line(
+            "drwxr-xr-x 2 admin admin 4096 Jan 31 2021 .",
+            entry
+        ));
+        REQUIRE_FALSE(rs::ftp::parse_list_line("", entry));
+    }
+}
+
+TEST_CASE("Listing parse test", "[listing]")
+{
+    auto buffer = to_buffer(
+        "type=cdir; .\r\n"
+        "type=file;size=1; a\r\n"
+        "type=dir; b\n"
+        "type=file;size=2; c"
+    );
+    auto entries = rs::ftp::parse_listing(buffer, true);
+
+    REQUIRE(entries.size() == 3);
+    REQUIRE(entries[0].name == "a");
+    REQUIRE(entries[1].name == "b");
+    REQUIRE(entries[2].name == "c");
+
+    rs::ftp::directory_listing listing(std::move(buffer), std::move(entries));
+    auto const moved = std::move(listing);
+
+    REQUIRE(moved.size() == 3);
+    REQUIRE(moved[2].size == 2);
+    REQUIRE(moved[0].name == "a");
+}
+
+TEST_CASE("Entry name safety test", "[listing]")
+{
+    REQUIRE(rs::ftp::is_safe_entry_name("document1.txt"));
+    REQUIRE(rs::ftp::is_safe_entry_name("my documents"));
+    REQUIRE(rs::ftp::is_safe_entry_name("..hidden"));
+
+    REQUIRE_FALSE(rs::ftp::is_safe_entry_name(""));
+    REQUIRE_FALSE(rs::ftp::is_safe_entry_name("."));
+    REQUIRE_FALSE(rs::ftp::is_safe_entry_name(".."));
+    REQUIRE_FALSE(rs::ftp::is_safe_entry_name("../../.bashrc"));
+    REQUIRE_FALSE(rs::ftp::is_safe_entry_name("/etc/x"));
+    REQUIRE_FALSE(rs::ftp::is_safe_entry_name("..\\..\\x"));
+
+#if defined(_WIN32)
+    REQUIRE_FALSE(rs::ftp::is_safe_entry_name("C:x"));
+    REQUIRE(rs::ftp::is_safe_entry_name("1:x"));
+#else
+    REQUIRE(rs::ftp::is_safe_entry_name("C:x"));
+    REQUIRE(rs::ftp::is_safe_entry_name("a:b"));
+    REQUIRE(rs::ftp::is_safe_entry_name("x:1.log"));
+#endif
+}
@@ -0,0 +1,184 @@
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <string_view>
+
+#include "util.hpp"
+
+
+TEST_CASE("Number parse test", "[util][parse]")
+{
+    int value{0};
+
+    SECTION("Number followed by text")
+    {
+        std::string_view text{"123x"};
+        REQUIRE(rs::ftp::consume_number(text, 3, value));
+        REQUIRE(value == 123);
+        REQUIRE(text == "x");
+    }
+
+    SECTION("Extra digits")
+    {
+        std::string_view text{"1234"};
+        REQUIRE_FALSE(rs::ftp::consume_number(text, 3, value));
+        REQUIRE(text == "1234");
+    }
+
+    SECTION("Leading minus")
+    {
+        std::string_view text{"-12"};
+        REQUIRE_FALSE(rs::ftp::consume_number(text, 3, value));
+        REQUIRE(text == "-12");
+    }
+
+    SECTION("No digits")
+    {
+        std::string_view empty{};
+        std::string_view letters{"x12"};
+        REQUIRE_FALSE(rs::ftp::consume_number(empty, 3, value));
+        REQUIRE_FALSE(rs::ftp::consume_number(letters, 3, value));
+    }
+
+    SECTION("Out of range")
+    {
+        std::string_view text{"65536"};
+        unsigned short port{0};
+        REQUIRE_FALSE(rs::ftp::consume_number(text, 5, port));
+    }
+}
+
+TEST_CASE("Reply code parse test", "[util][parse]")
+{
+    using rs::ftp::reply_code;
+
+    REQUIRE(rs::ftp::parse_reply_code("213 446\r\n") == reply_code::FILE_STATUS_213);
+    REQUIRE(rs::ftp::parse_reply_code("211-Features:\r\n") == reply_code::SYSTEM_STATUS_211);
+    REQUIRE(rs::ftp::parse_reply_code("200") == reply_code::OK_200);
+
+    REQUIRE_FALSE(rs::ftp::parse_reply_code(""));
+    REQUIRE_FALSE(rs::ftp::parse_reply_code("22"));
+    REQUIRE_FALSE(rs::ftp::parse_reply_code("123x"));
+    REQUIRE_FALSE(rs::ftp::parse_reply_code("2134 text"));
+    REQUIRE_FALSE(rs::ftp::parse_reply_code("-21 text"));
+    REQUIRE_FALSE(rs::ftp::parse_reply_code(" 213 text"));
+}
+
+TEST_CASE("PASV reply parse test", "[util][parse][pasv]")
+{
+    SECTION("Valid")
+    {
+        auto const [address, port] = rs::ftp::parse_pasv_ipv4_port_reply(
+            "227 Entering Passive Mode (192,168,100,200,195,80).\r\n"
+        );
+
+        REQUIRE(address == std::array<int, 4>{192, 168, 100, 200});
+        REQUIRE(port == 50000);
+    }
+
+    SECTION("Text in parentheses before the address")
+    {
+        auto const [address, port] = rs::ftp::parse_pasv_ipv4_port_reply(
+            "227 Entering Passive Mode (ok) (127,0,0,1,0,21)"
+        );
+
+        REQUIRE(address == std::array<int, 4>{127, 0, 0, 1});
+        REQUIRE(port == 21);
+    }
+
+    SECTION("Invalid")
+    {
+        REQUIRE_THROWS(rs::ftp::parse_pasv_ipv4_port_reply("227 Entering Passive Mode"));
+        REQUIRE_THROWS(rs::ftp::parse_pasv_ipv4_port_reply("227 (256,0,0,1,4,1)"));
+        REQUIRE_THROWS(rs::ftp::parse_pasv_ipv4_port_reply("227 (127,0,0,1,4,256)"));
+        REQUIRE_THROWS(rs::ftp::parse_pasv_ipv4_port_reply("227 (1270,0,0,1,4,1)"));
+        REQUIRE_THROWS(rs::ftp::parse_pasv_ipv4_port_reply("227 (127,0,0,-1,4,1)"));
+        REQUIRE_THROWS(rs::ftp::parse_pasv_ipv4_port_reply("227 (127,0,0,1,4)"));
+        REQUIRE_THROWS(rs::ftp::parse_pasv_ipv4_port_reply("227 (127,0,0,1,4,1"));
+        REQUIRE_THROWS(rs::ftp::parse_pasv_ipv4_port_reply("227 (127,0,0,1,4,1,5)"));
+    }
+}
+
+TEST_CASE("EPSV reply parse test", "[util][parse][epsv]")
+{
+    SECTION("Valid")
+    {
+        auto const reply = rs::ftp::parse_epsv_reply(
+            "229 Entering Extended Passive Mode (|||50000|)\r\n"
+        );
+
+        REQUIRE(reply.address.empty());
+        REQUIRE(reply.port == 50000);
+        REQUIRE(rs::ftp::parse_epsv_reply("229 (|||65535|)").port == 65535);
+    }
+
+    SECTION("Invalid")
+    {
+        REQUIRE_THROWS(rs::ftp::parse_epsv_reply("229 Entering Extended Passive Mode"));
+        REQUIRE_THROWS(rs::ftp::parse_epsv_reply("229 (!!!50000!)"));
+        REQUIRE_THROWS(rs::ftp::parse_epsv_reply("229 (|||50000!)"));
+        REQUIRE_THROWS(rs::ftp::parse_epsv_reply("229 (|||65536|)"));
+        REQUIRE_THROWS(rs::ftp::parse_epsv_reply("229 (|||500000|)"));
+        REQUIRE_THROWS(rs::ftp::parse_epsv_reply("229 (|||-1|)"));
+        REQUIRE_THROWS(rs::ftp::parse_epsv_reply("229 (||||)"));
+        REQUIRE_THROWS(rs::ftp::parse_epsv_reply("229 (|||50000|"));
+    }
+}
+
+TEST_CASE("Reply assembly test", "[util][parse][reply]")
+{
+    SECTION("Single line")
+    {
+        REQUIRE(rs::ftp::reply_size("200 NOOP ok.\r\n") == 14);
+        REQUIRE(rs::ftp::reply_size("200 NOOP ok.") == 0);
+        REQUIRE(rs::ftp::reply_size("") == 0);
+    }
+
+    SECTION("Multi-line block with other codes inside")
+    {
+        std::string const reply{
+            "211-Features:\r\n"
+            "213 is not the end\r\n"
+            "211-nor is this\r\n"
+            " 211 nor this\r\n"
+            "2110 nor this\r\n"
+            "211 End\r\n"
+        };
+
+        REQUIRE(rs::ftp::reply_size(reply) == reply.size());
+        REQUIRE(rs::ftp::reply_size(reply + "200 next\r\n") == reply.size());
+    }
+
+    SECTION("Split across reads")
+    {
+        std::string const reply{"211-Features:\r\n EPSV\r\n211 End\r\n"};
+        std::string received;
+
+        for (std::size_t i = 0; i < reply.size(); ++i)
+        {
+            REQUIRE(rs::ftp::reply_size(received) == 0);
+            received += reply[i];
+        }
+
+        REQUIRE(rs::ftp::reply_size(received) == reply.size());
+    }
+
+    SECTION("Two replies in one read")
+    {
+        std::string received{
+            "226 Transfer complete.\r\n"
+            "229 Entering Extended Passive Mode (|||50000|)\r\n"
+        };
+
+        auto size{rs::ftp::reply_size(received)};
+        REQUIRE(received.substr(0, size) == "226 Transfer complete.\r\n");
+        received.erase(0, size);
+
+        size = rs::ftp::reply_size(received);
+        REQUIRE(size == received.size());
+        REQUIRE(rs::ftp::parse_epsv_reply(received.substr(0, size)).port == 50000);
+        received.erase(0, size);
+
+        REQUIRE(rs::ftp::reply_size(received) == 0);
+    }
+}
@@ -0,0 +1,242 @@
+#include <catch2/catch.hpp>
+
+#include <thread>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <system_error>
+
+#include <unistd.h>
+
+#include <ftp/session_pool.hpp>
+
+
+static auto pool_options() -> rs::ftp::connection_options
+{
+    rs::ftp::connection_options opts;
+    opts.username = "admin";
+    opts.password = "admin";
+
+    if (auto server_hostname = getenv("FTP_SERVER_HOSTNAME"); server_hostname)
+    {
+        opts.server_hostname = server_hostname;
+    } else
+    {
+        opts.server_hostname = "localhost";
+    }
+
+    opts.server_port = 21;
+    opts.debug_output = true;
+
+    return opts;
+}
+
+// NOTE - Local files of a test, removed however the test leaves its scope.
+class temp_directory
+{
+public:
+    temp_directory() :
+        m_path(std::filesystem::temp_directory_path() /
+               ("ftp_session_pool_test_" + std::to_string(::getpid())))
+    {
+        std::filesystem::create_directories(m_path);
+    }
+
+    ~temp_directory()
+    {
+        std::error_code ignored_ec;
+        std::filesystem::remove_all(m_path, ignored_ec);
+    }
+
+    temp_directory(temp_directory const&) =delete;
+    auto operator=(temp_directory const&) -> temp_directory& =delete;
+
+    auto operator/(std::string const& a_filename) const -> std::string
+    {
+        return (m_path / a_filename).string();
+    }
+
+private:
+    std::filesystem::path m_path;
+};
+
+TEST_CASE("Session pool test", "[ftp][session_pool]")
+{
+    auto opts{pool_options()};
+    boost::asio::io_context io_context;
+    rs::ftp::session_pool pool(io_context, 2, std::chrono::milliseconds(200));
+
+    SECTION("Reuse")
+    {
+        rs::ftp::client* first_client{nullptr};
+        {
+            auto session{pool.acquire(opts)};
+            REQUIRE(session);
+            REQUIRE_NOTHROW(session->pwd());
+            first_client = &*session;
+        }
+
+        auto session{pool.acquire(opts)};
+        REQUIRE(&*session == first_client);
+        REQUIRE(pool.size(opts) == 1);
+    }
+
+    SECTION("Limit")
+    {
+        auto first{pool.acquire(opts)};
+        auto second{pool.acquire(opts)};
+        REQUIRE(pool.size(opts) == 2);
+
+        rs::ftp::session_pool::session third;
+        pool.async_acquire(opts, [&third](std::exception_ptr a_error,
+                                          rs::ftp::session_pool::session a_session)
+        {
+            REQUIRE(!a_error);
+            third = std::move(a_session);
+        });
+
+        io_context.poll();
+        REQUIRE(!third);
+
+        auto first_client{&*first};
+        first.release();
+        while (!third)
+        {
+            // NOTE - The poll() above stops the reactor once it runs out of work.
+            if (io_context.stopped())
+            {
+                io_context.restart();
+            }
+
+            io_context.run_one();
+        }
+        REQUIRE(&*third == first_client);
+        REQUIRE(pool.size(opts) == 2);
+    }
+
+    SECTION("Eviction")
+    {
+        {
+            auto session{pool.acquire(opts)};
+            REQUIRE_NOTHROW(session->close());
+        }
+
+        // NOTE - The closed session is replaced in the background.
+        auto session{pool.acquire(opts)};
+        REQUIRE(session->is_open());
+        REQUIRE_NOTHROW(session->noop());
+        REQUIRE(pool.size(opts) == 1);
+    }
+
+    SECTION("Keepalive")
+    {
+        pool.acquire(opts).release();
+
+        auto const deadline{std::chrono::steady_clock::now() + std::chrono::milliseconds(700)};
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            io_context.run_one_for(std::chrono::milliseconds(50));
+        }
+
+        REQUIRE(pool.keepalives(opts) > 0);
+
+        auto session{pool.acquire(opts)};
+        REQUIRE(session->is_open());
+        REQUIRE_NOTHROW(session->pwd());
+    }
+}
+
+TEST_CASE("Parallel download test", "[ftp][session_pool][download]")
+{
+    auto opts{pool_options()};
+    boost::asio::io_context io_context;
+    rs::ftp::session_pool pool(io_context, 3);
+
+    std::vector<char> expected;
+    {
+        rs::ftp::client client(io_context, opts);
+        REQUIRE_NOTHROW(client.connect());
+        REQUIRE_NOTHROW(client.login());
+        REQUIRE_NOTHROW(expected = client.download("image.jpeg"));
+        REQUIRE(client.size("image.jpeg") == expected.size());
+        REQUIRE_NOTHROW(client.close());
+    }
+
+    SECTION("Vector")
+    {
+        for (std::size_t segments : {1, 3, 7})
+        {
+            std::vector<char> data;
+            REQUIRE_NOTHROW(data = pool.download_parallel(opts, "image.jpeg", segments));
+            REQUIRE(data == expected);
+        }
+
+        REQUIRE(pool.size(opts) == 3);
+    }
+
+    SECTION("Stream")
+    {
+        temp_directory local;
+        {
+            std::ofstream ofs(local / "parallel_image.jpeg", std::ios::binary);
+            REQUIRE_NOTHROW(pool.download_parallel(opts, "image.jpeg", ofs, 4));
+        }
+
+        std::ifstream ifs(local / "parallel_image.jpeg", std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(ifs)),
+                               std::istreambuf_iterator<char>());
+        REQUIRE(data == expected);
+    }
+
+    SECTION("Stream that fails")
+    {
+        // NOTE - A stream that is not open fails every write.
+        std::ofstream ofs;
+        REQUIRE_THROWS(pool.download_parallel(opts, "image.jpeg", ofs, 4));
+        REQUIRE(pool.download_parallel(opts, "image.jpeg", 4) == expected);
+    }
+
+    SECTION("More segments than whole ranges")
+    {
+        // NOTE - 446 bytes in 300 segments - 223 ranges of 2 bytes.
+        auto const document{pool.download_parallel(opts, "documents/document1.txt", 1)};
+        REQUIRE(document.size() == 446);
+        REQUIRE(pool.download_parallel(opts, "documents/document1.txt", 300) == document);
+    }
+
+    SECTION("Missing file")
+    {
+        REQUIRE_THROWS(pool.download_parallel(opts, "non_existent_file", 4));
+    }
+}
+
+TEST_CASE("Parallel upload test", "[ftp][session_pool][upload]")
+{
+    auto opts{pool_options()};
+    boost::asio::io_context io_context;
+    rs::ftp::session_pool pool(io_context, 3);
+
+    temp_directory local;
+    auto const local_path{local / "parallel_upload.bin"};
+
+    std::vector<char> expected(1 << 20);
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+        expected[i] = static_cast<char>(i * 7 + i / 251);
+    }
+    {
+        std::ofstream ofs(local_path, std::ios::binary);
+        ofs.write(expected.data(), expected.size());
+    }
+
+    for (std::size_t segments : {1, 4})
+    {
+        REQUIRE_NOTHROW(pool.upload_parallel(opts, "parallel_upload.bin", local_path, segments));
+
+        auto session{pool.acquire(opts)};
+        REQUIRE(session->download("parallel_upload.bin") == expected);
+        REQUIRE_NOTHROW(session->remove_file("parallel_upload.bin"));
+    }
+
+    REQUIRE_THROWS(pool.upload_parallel(opts, "parallel_upload.bin", "non_existent_file", 4));
+}
@@ -0,0 +1,244 @@
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+#include <ftp/transfer_engine.hpp>
+
+
+static auto read_file(std::string const& a_path) -> std::vector<char>
+{
+    std::ifstream ifs(a_path, std::ios::binary);
+
+    return std::vector<char>((std::istreambuf_iterator<char>(ifs)),
+                             std::istreambuf_iterator<char>());
+}
+
+TEST_CASE("Transfer engine test", "[ftp][transfer_engine]")
+{
+    rs::ftp::connection_options opts;
+    opts.username = "admin";
+    opts.password = "admin";
+
+    if (auto server_hostname = getenv("FTP_SERVER_HOSTNAME"); server_hostname)
+    {
+        opts.server_hostname = server_hostname;
+    } else
+    {
+        opts.server_hostname = "localhost";
+    }
+
+    opts.server_port = 21;
+    opts.debug_output = true;
+
+    boost::asio::io_context io_context;
+    rs::ftp::session_pool pool(io_context, 4);
+    // NOTE - Smaller than the image, so the downloads run one at a time.
+    rs::ftp::transfer_engine engine(pool, opts, 4, 1024);
+
+    std::size_t completed{0};
+    std::size_t failed{0};
+    auto on_complete = [&](std::exception_ptr a_error)
+    {
+        ++completed;
+        failed += a_error ? 1 : 0;
+    };
+
+    for (int i = 0; i < 6; ++i)
+    {
+        engine.add({
+            rs::ftp::transfer_job::direction::DOWNLOAD,
+            "image.jpeg",
+            "engine_image_" + std::to_string(i) + ".jpeg",
+            on_complete
+        });
+    }
+
+    SECTION("Success")
+    {
+        REQUIRE_NOTHROW(engine.run());
+        REQUIRE(completed == 6);
+        REQUIRE(failed == 0);
+
+        auto const expected{read_file("engine_image_0.jpeg")};
+        REQUIRE(expected.size() == 59882);
+
+        for (int i = 0; i < 6; ++i)
+        {
+            engine.add({
+                rs::ftp::transfer_job::direction::UPLOAD,
+                "engine_upload_" + std::to_string(i) + ".jpeg",
+                "engine_image_" + std::to_string(i) + ".jpeg",
+                on_complete
+            });
+        }
+        REQUIRE_NOTHROW(engine.run());
+        REQUIRE(completed == 12);
+
+        auto session{pool.acquire(opts)};
+        for (int i = 0; i < 6; ++i)
+        {
+            auto const remote{"engine_upload_" + std::to_string(i) + ".jpeg"};
+            REQUIRE(session->download(remote) == expected);
+            REQUIRE_NOTHROW(session->remove_file(remote));
+        }
+    }
+
+    SECTION("Errors")
+    {
+        std::filesystem::remove("missing");
+        engine.add({rs::ftp::transfer_job::direction::DOWNLOAD, "non_existent_file", "missing"});
+        engine.add({rs::ftp::transfer_job::direction::UPLOAD, "missing", "non_existent_file"});
+
+        try
+        {
+            engine.run();
+            FAIL("transfer_error not thrown");
+        } catch (rs::ftp::transfer_error const& e)
+        {
+            REQUIRE(e.errors().size() == 2);
+        }
+
+        REQUIRE_FALSE(std::filesystem::exists("missing"));
+        REQUIRE_FALSE(std::filesystem::exists("missing.part"));
+
+        REQUIRE(completed == 6);
+        REQUIRE(failed == 0);
+    }
+}
+
+TEST_CASE("Transfer budget test", "[ftp][transfer_engine]")
+{
+    rs::ftp::connection_options opts;
+    opts.username = "admin";
+    opts.password = "admin";
+
+    if (auto server_hostname = getenv("FTP_SERVER_HOSTNAME"); server_hostname)
+    {
+        opts.server_hostname = server_hostname;
+    } else
+    {
+        opts.server_hostname = "localhost";
+    }
+
+    opts.server_port = 21;
+    opts.debug_output = true;
+
+    boost::asio::io_context io_context;
+    rs::ftp::session_pool pool(io_context, 4);
+    // NOTE - Room for one large file and a small one, not for two large ones.
+    rs::ftp::transfer_engine engine(pool, opts, 4, 61000);
+
+    std::ofstream("budget_large.bin", std::ios::binary) << std::string(60000, 'l');
+    std::ofstream("budget_small.bin", std::ios::binary) << std::string(100, 's');
+
+    std::vector<std::string> const locals{"budget_large.bin", "budget_large.bin", "budget_small.bin"};
+    std::vector<std::string> completed;
+    for (std::size_t i = 0; i < locals.size(); ++i)
+    {
+        auto const remote{"budget_" + std::to_string(i) + ".bin"};
+        engine.add({
+            rs::ftp::transfer_job::direction::UPLOAD,
+            remote,
+            locals[i],
+            [&completed, remote](std::exception_ptr a_error)
+            {
+                CHECK_FALSE(a_error);
+                completed.push_back(remote);
+            }
+        });
+    }
+
+    REQUIRE_NOTHROW(engine.run());
+    REQUIRE(completed.size() == 3);
+
+    // NOTE - The small file fits next to the first large one, but waits behind the second.
+    auto const position = [&completed](std::string const& a_remote)
+    {
+        return std::find(completed.begin(), completed.end(), a_remote) - completed.begin();
+    };
+    REQUIRE(position("budget_0.bin") < position("budget_2.bin"));
+
+    auto session{pool.acquire(opts)};
+    for (auto const& remote : completed)
+    {
+        REQUIRE_NOTHROW(session->remove_file(remote));
+    }
+    std::filesystem::remove("budget_large.bin");
+    std::filesystem::remove("budget_small.bin");
+}
+
+TEST_CASE("Mirror test", "[ftp][transfer_engine][mirror]")
+{
+    rs::ftp::connection_options opts;
+    opts.username = "admin";
+    opts.password = "admin";
+
+    if (auto server_hostname = getenv("FTP_SERVER_HOSTNAME"); server_hostname)
+    {
+        opts.server_hostname = server_hostname;
+    } else
+    {
+        opts.server_hostname = "localhost";
+    }
+
+    opts.server_port = 21;
+    opts.debug_output = true;
+
+    boost::asio::io_context io_context;
+    rs::ftp::session_pool pool(io_context, 4);
+    rs::ftp::transfer_engine engine(pool, opts, 4);
+
+    std::filesystem::remove_all("mirror_down");
+    std::filesystem::remove_all("mirror_up");
+
+    // NOTE - Other tests add and remove files, only image.jpeg and documents/ are always there.
+    REQUIRE_NOTHROW(engine.mirror_down("/", "mirror_down"));
+    REQUIRE(read_file("mirror_down/image.jpeg").size() == 59882);
+    REQUIRE(std::filesystem::is_directory("mirror_down/documents"));
+
+    REQUIRE_NOTHROW(engine.mirror_up("mirror_down", "mirror_up"));
+    REQUIRE_NOTHROW(engine.mirror_down("mirror_up", "mirror_up"));
+
+    std::vector<std::string> files;
+    std::vector<std::string> directories;
+    for (auto const& entry : std::filesystem::recursive_directory_iterator("mirror_down"))
+    {
+        auto const relative{
+            std::filesystem::relative(entry.path(), "mirror_down").generic_string()
+        };
+
+        if (entry.is_directory())
+        {
+            directories.push_back(relative);
+        } else
+        {
+            files.push_back(relative);
+            REQUIRE(read_file("mirror_up/" + relative) == read_file(entry.path().string()));
+        }
+    }
+
+    // NOTE - Mirroring up again finds the remote directories in place.
+    REQUIRE_NOTHROW(engine.mirror_up("mirror_down", "mirror_up"));
+
+    rs::ftp::command_batch cleanup;
+    for (auto const& file : files)
+    {
+        cleanup.remove_file("mirror_up/" + file);
+    }
+    for (auto it = directories.rbegin(); it != directories.rend(); ++it)
+    {
+        cleanup.rmdir("mirror_up/" + *it);
+    }
+    cleanup.rmdir("mirror_up");
+
+    auto session{pool.acquire(opts)};
+    for (auto const& reply : session->execute(cleanup))
+    {
+        REQUIRE(!reply.error);
+    }
+}